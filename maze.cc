@@ -4,423 +4,832 @@
  *
  * Controls:
  *  Arrow keys  – move the player
- *  Space       – show the shortest path (BFS)
+ *  Space       – show the shortest path
+ *  S           – cycle the solver (BFS / bidirectional BFS / A* / distance field /
+ *                bitboard BFS / Dijkstra / junction graph by steps / by cost)
+ *  H           – toggle the distance-to-target heat map
+ *  M           – cycle the render mode (immediate / batched / texture)
  *  R           – reset current maze
- *  N           – generate a new maze
+ *  N           – show the next maze (generated in the background)
+ *  G           – cycle the generator algorithm
  *  A           – auto-solve (animated)
+ *  + / -       – zoom in / out (also the mouse wheel)
+ *  F           – fit the whole maze in the window
+ *  W / L       – save / load the maze (maze.mz or the --save/--load file)
+ *  I           – toggle the instrumentation HUD
+ *  Page up/down – show the level above / below (--levels)
+ *  Mouse drag  – pan
  *  ESC         – quit
+ *
+ * Run with --headless to generate and solve mazes without a window.
  */
 
-#include <OpenGL/gl.h>
+/* maze_render.h picks the GL headers (and their extension prototypes), so
+ * it has to come before GLUT */
+#include "maze_render.h"
+
+#ifdef __APPLE__
 #include <GLUT/glut.h>
-#include <vector>
-#include <queue>
-#include <stack>
-#include <unordered_map>
-#include <algorithm>
-#include <random>
-#include <ctime>
+#else
+#include <GL/glut.h>
+#endif
 #include <iostream>
-#include <chrono>
+#include <cstdio>
+#include <new>
 
-const int CELL_SIZE   = 50;
-const int MAZE_WIDTH  = 21;
-const int MAZE_HEIGHT = 21;
+#include "maze_agents.h"
+#include "maze_core.h"
+#include "maze_file.h"
+#include "maze_gpu.h"
+#include "maze_levels.h"
+#include "maze_prefetch.h"
+#include "maze_stats.h"
 
-enum CellType {
-    WALL,
-    PATH,
-    PLAYER,
-    TARGET
-};
+const int MAX_WINDOW_SIZE = 1000;
 
-struct Cell {
-    int x, y;
-    CellType type;
-    bool visited = false;
-};
+Maze* shownMaze = nullptr; // the maze in the window, for the GLUT callbacks
+
+/* Auto-solve animation: advances by elapsed time, not by timer ticks */
+auto lastAutoMoveTime = std::chrono::steady_clock::now();
+double autoMoveRate = 50.0;  // cells per second, 0 for instant
+double pendingSteps = 0;     // fraction of a step carried to the next tick
+double generationBudget = 0; // ms of carving per frame for N and G, 0 for none
+bool timerRunning = false;
 
-struct Vector2i {
-    int x, y;
-    Vector2i(int x = 0, int y = 0) : x(x), y(y) {}
-    bool operator==(const Vector2i& other) const {
-        return x == other.x && y == other.y;
+/* GLUT callback functions */
+MazeRenderer renderer;
+GpuDistanceField gpuField;
+DistanceFieldBackend* fieldBackend = nullptr; // set by --gpu-field when available
+uint64_t drawnRevision = UINT64_MAX; // Maze revision on screen
+bool hudShown = false;
+
+/* Hot-path timings in the top-left corner, in window pixels */
+void drawHud() {
+    char lines[STAT_SECTION_COUNT + 4][96];
+    int count = 0;
+    std::snprintf(lines[count++], sizeof(lines[0]), "%-12s %8s %8s %8s %8s",
+                  "section", "last ms", "mean ms", "max ms", "calls");
+    const HotPathStats& stats = hotPathStats();
+    for (int s = 0; s < STAT_SECTION_COUNT; s++) {
+        const SectionStats& section = stats.sections[s];
+        uint64_t calls = section.calls.load();
+        std::snprintf(lines[count++], sizeof(lines[0]), "%-12s %8.3f %8.3f %8.3f %8llu",
+                      statSectionName(StatSection(s)), section.lastNanos.load() / 1e6,
+                      calls ? section.totalNanos.load() / 1e6 / calls : 0.0,
+                      section.maxNanos.load() / 1e6, static_cast<unsigned long long>(calls));
     }
-};
+    std::snprintf(lines[count++], sizeof(lines[0]), "last solve   %llu cells expanded, queue peak %llu",
+                  static_cast<unsigned long long>(stats.lastCellsExpanded.load()),
+                  static_cast<unsigned long long>(stats.lastQueuePeak.load()));
+    std::snprintf(lines[count++], sizeof(lines[0]), "allocations  %llu",
+                  static_cast<unsigned long long>(allocationCount().load()));
 
-struct Color {
-    float r, g, b;
-    Color(float r, float g, float b) : r(r), g(g), b(b) {}
-};
+    int width = glutGet(GLUT_WINDOW_WIDTH), height = glutGet(GLUT_WINDOW_HEIGHT);
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glOrtho(0, width, height, 0, -1, 1);
+    glMatrixMode(GL_MODELVIEW);
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glColor4f(0.0f, 0.0f, 0.0f, 0.7f);
+    glRecti(6, 6, 6 + 8 * 48 + 12, 6 + 15 * count + 10);
+    glDisable(GL_BLEND);
 
-class Maze {
-public:
-    Maze() {
-        rng.seed(std::time(nullptr));
-        cells.resize(MAZE_HEIGHT, std::vector<Cell>(MAZE_WIDTH));
-        generateMaze();
-        reset();
+    glColor3f(1.0f, 1.0f, 1.0f);
+    for (int i = 0; i < count; i++) {
+        glRasterPos2i(12, 6 + 15 * (i + 1));
+        for (const char* c = lines[i]; *c; c++) glutBitmapCharacter(GLUT_BITMAP_8_BY_13, *c);
     }
+}
 
-    /* Generate a perfect maze using recursive back-tracking */
-    void generateMaze() {
-        for (int y = 0; y < MAZE_HEIGHT; y++) {
-            for (int x = 0; x < MAZE_WIDTH; x++) {
-                cells[y][x] = {x, y, WALL};
-            }
-        }
+void display() {
+    if (shownMaze) {
+        renderer.draw(*shownMaze);
+        if (hudShown) drawHud();
+        drawnRevision = shownMaze->getRevision();
+    }
+    glutSwapBuffers();
+}
 
-        cells[1][1].type = PATH;
-        cells[MAZE_HEIGHT - 2][MAZE_WIDTH - 2].type = PATH;
+/* Ask for a frame only when something visible changed since the last one;
+ * expose events still repaint through GLUT directly */
+void redisplayIfChanged() {
+    if (shownMaze && shownMaze->getRevision() != drawnRevision) glutPostRedisplay();
+}
 
-        std::stack<Vector2i> stack;
-        stack.push(Vector2i(1, 1));
-        cells[1][1].visited = true;
+void startTimer();
 
-        while (!stack.empty()) {
-            Vector2i current = stack.top();
-            int x = current.x;
-            int y = current.y;
+/* --levels: the shown Maze displays one level of a LevelMaze; Space, N and
+ * the page keys work on the levels, the keys that play or edit do nothing */
+LevelMaze* levelMaze = nullptr;
+LevelScratch levelScratch;
+std::vector<Vector3i> levelPath;
+int shownLevel = 0;
 
-            std::vector<Vector2i> neighbors = getUnvisitedNeighbors(x, y);
+void showCurrentLevel() {
+    showLevel(*levelMaze, shownLevel, levelPath, *shownMaze);
+    std::cout << "Level " << shownLevel + 1 << " of " << levelCount(*levelMaze) << std::endl;
+}
 
-            if (!neighbors.empty()) {
-                std::uniform_int_distribution<int> dist(0, neighbors.size() - 1);
-                Vector2i next = neighbors[dist(rng)];
-                int nx = next.x;
-                int ny = next.y;
+void solveLevels() {
+    SolveStats stats;
+    levelMaze->solve(levelMaze->getStart(), levelMaze->getTarget(), levelScratch, levelPath, stats);
+    std::cout << "Show shortest path (bfs: " << stats.cellsExpanded << " cells expanded, queue peak "
+              << stats.queuePeak << ", " << stats.microseconds << " us, " << levelPath.size()
+              << " cells)" << std::endl;
+    showCurrentLevel();
+}
 
-                int midX = (x + nx) / 2;
-                int midY = (y + ny) / 2;
-                cells[midY][midX].type = PATH;
-                cells[ny][nx].type = PATH;
+/* Mazes for N and G come from a background thread, are carved a slice per
+ * frame by the timer (--progressive), or are generated on the spot
+ * (--prefetch 0).  While no prefetched maze is ready a timer polls for it. */
+MazePrefetcher* prefetcher = nullptr;
+bool waitingForMaze = false;
+
+/* Move the next maze into the shown one, keeping the solver and heat map
+ * that were picked since it was queued */
+bool takeNextMaze() {
+    Maze& maze = *shownMaze;
+    SolverType solver = maze.getSolver();
+    bool heatMap = maze.isHeatMapShown();
+    if (!prefetcher->takeNext(maze)) return false;
+    maze.setDistanceFieldBackend(fieldBackend);
+    maze.setSolver(solver);
+    maze.setHeatMapShown(heatMap);
+    return true;
+}
 
-                cells[ny][nx].visited = true;
-                stack.push(Vector2i(nx, ny));
-            } else {
-                stack.pop();
-            }
-        }
+void pollNextMaze(int value) {
+    if (!waitingForMaze) return;
+    if (!takeNextMaze()) {
+        glutTimerFunc(16, pollNextMaze, 0);
+        return;
     }
+    waitingForMaze = false;
+    std::cout << "Generate new maze" << std::endl;
+    redisplayIfChanged();
+}
 
-    /* Reset player & target positions, clear visited flags */
-    void reset() {
-        for (auto& row : cells) {
-            for (auto& cell : row) {
-                cell.visited = false;
-                if (cell.type == PLAYER) cell.type = PATH;
-            }
+void showNextMaze() {
+    if (generationBudget > 0) {
+        shownMaze->beginGeneration();
+        startTimer();
+        std::cout << "Generating new maze" << std::endl;
+    } else if (!prefetcher) {
+        shownMaze->generateNewMaze();
+        std::cout << "Generate new maze" << std::endl;
+    } else if (!waitingForMaze) {
+        if (takeNextMaze()) {
+            std::cout << "Generate new maze" << std::endl;
+        } else {
+            waitingForMaze = true;
+            std::cout << "Waiting for the next maze" << std::endl;
+            glutTimerFunc(16, pollNextMaze, 0);
         }
-
-        playerPos = Vector2i(1, 1);
-        cells[playerPos.y][playerPos.x].type = PLAYER;
-
-        targetPos = Vector2i(MAZE_WIDTH - 2, MAZE_HEIGHT - 2);
-        cells[targetPos.y][targetPos.x].type = TARGET;
-
-        pathFound        = false;
-        autoMoving       = false;
-        movePath.clear();
-        currentMoveIndex = 0;
     }
+}
 
-    void generateNewMaze() {
-        generateMaze();
-        reset();
-    }
+/* Queue mazes that follow the shown one after its settings changed */
+void restartPrefetch() {
+    if (prefetcher) prefetcher->restart(*shownMaze);
+}
 
-    /* Attempt to move the player by (dx, dy) */
-    bool movePlayer(int dx, int dy) {
-        int newX = playerPos.x + dx;
-        int newY = playerPos.y + dy;
+/* File used by the W and L keys */
+std::string mazeFile = "maze.mz";
 
-        if (isValidPosition(newX, newY) && cells[newY][newX].type != WALL) {
-            cells[playerPos.y][playerPos.x].type = PATH;
-            playerPos = Vector2i(newX, newY);
-            cells[newY][newX].type = PLAYER;
-            return true;
-        }
+bool loadMazeFile(Maze& maze, const std::string& path) {
+    MappedFile file;
+    PackedMaze packed;
+    std::string error;
+    if (!file.open(path.c_str(), error) || !packed.open(file.data(), file.size(), error)) {
+        std::cerr << "Cannot load " << path << ": " << error << std::endl;
         return false;
     }
+    loadMaze(maze, packed);
+    return true;
+}
 
-    /* Breadth-First Search to find the shortest path */
-    void findPathBFS() {
-        resetVisited();
-        std::queue<Vector2i> queue;
-        std::unordered_map<int, Vector2i> parentMap;
-
-        queue.push(playerPos);
-        cells[playerPos.y][playerPos.x].visited = true;
-
-        while (!queue.empty()) {
-            Vector2i current = queue.front();
-            queue.pop();
-
-            if (current == targetPos) {
-                pathFound = true;
-                reconstructPath(parentMap);
-                return;
-            }
-
-            for (const auto& dir : directions) {
-                int newX = current.x + dir.x;
-                int newY = current.y + dir.y;
+void keyboard(unsigned char key, int x, int y) {
+    if (!shownMaze) return;
+    /* Keys that play or solve wait for a progressive generation to end */
+    if (shownMaze->isGenerating() && key && std::strchr(" hHrRaAwW", key)) return;
+    if (levelMaze && key && std::strchr("hHsSrRgGaAwWlL", key)) return;
 
-                if (isValidPosition(newX, newY) && !cells[newY][newX].visited &&
-                    cells[newY][newX].type != WALL) {
-                    cells[newY][newX].visited = true;
-                    queue.push(Vector2i(newX, newY));
-                    parentMap[newY * MAZE_WIDTH + newX] = current;
-                }
+    switch (key) {
+        case ' ': { // Space
+            if (levelMaze) {
+                solveLevels();
+                break;
             }
+            shownMaze->findPath();
+            const SolveStats& stats = shownMaze->getLastSolveStats();
+            std::cout << "Show shortest path (" << solverName(stats.solver) << ": "
+                      << stats.cellsExpanded << " cells expanded, queue peak " << stats.queuePeak
+                      << ", " << stats.microseconds << " us, cost " << stats.pathCost << ")" << std::endl;
+            break;
         }
-    }
-
-    /* Prepare the animated auto-solve */
-    void prepareAutoMove() {
-        findPathBFS();
-        if (pathFound) {
-            autoMoving       = true;
-            currentMoveIndex = 0;
-            movePath         = path;
-            movePath.insert(movePath.begin(), playerPos);
+        case 'm':
+        case 'M': {
+            RenderMode next = RenderMode((renderer.getMode() + 1) % RENDER_MODE_COUNT);
+            renderer.setMode(next);
+            std::cout << "Render mode: " << renderModeName(next) << std::endl;
+            glutPostRedisplay();
+            break;
         }
-    }
-
-    /* Execute one step of the auto-solve animation */
-    bool autoMoveStep() {
-        if (!autoMoving || currentMoveIndex >= movePath.size() - 1) {
-            autoMoving = false;
-            return false;
+        case 'h':
+        case 'H':
+            shownMaze->setHeatMapShown(!shownMaze->isHeatMapShown());
+            restartPrefetch();
+            std::cout << "Heat map " << (shownMaze->isHeatMapShown() ? "on" : "off") << std::endl;
+            break;
+        case 's':
+        case 'S': {
+            SolverType next = SolverType((shownMaze->getSolver() + 1) % SOLVER_COUNT);
+            shownMaze->setSolver(next);
+            std::cout << "Solver: " << solverName(next) << std::endl;
+            break;
         }
-
-        currentMoveIndex++;
-        Vector2i nextPos = movePath[currentMoveIndex];
-
-        cells[playerPos.y][playerPos.x].type = PATH;
-        playerPos = nextPos;
-        cells[playerPos.y][playerPos.x].type = PLAYER;
-
-        if (playerPos == targetPos) autoMoving = false;
-        return true;
-    }
-
-    /* Render the entire maze */
-    void draw() {
-        glClear(GL_COLOR_BUFFER_BIT);
-
-        for (int y = 0; y < MAZE_HEIGHT; y++) {
-            for (int x = 0; x < MAZE_WIDTH; x++) {
-                Color color(0.3f, 0.3f, 0.3f);
-
-                switch (cells[y][x].type) {
-                    case WALL:   color = Color(0.3f, 0.3f, 0.3f); break;
-                    case PATH:   color = Color(0.9f, 0.9f, 0.9f); break;
-                    case PLAYER: color = Color(0.26f, 0.53f, 0.96f); break;
-                    case TARGET: color = Color(0.96f, 0.26f, 0.26f); break;
-                }
-                drawCell(x, y, color);
+        case 'r':
+        case 'R':
+            shownMaze->reset();
+            std::cout << "Reset maze" << std::endl;
+            break;
+        case 'n':
+        case 'N':
+            if (levelMaze) {
+                levelMaze->generate();
+                levelPath.clear();
+                std::cout << "Generate new maze" << std::endl;
+                showCurrentLevel();
+                break;
             }
+            showNextMaze();
+            break;
+        case 'g':
+        case 'G': {
+            GeneratorType next = GeneratorType((shownMaze->getGenerator() + 1) % GENERATOR_COUNT);
+            shownMaze->setGenerator(next);
+            restartPrefetch();
+            std::cout << "Generator: " << generatorName(next) << std::endl;
+            showNextMaze();
+            break;
         }
-
-        if (pathFound) {
-            Color pathColor(0.26f, 0.96f, 0.68f);
-            for (const auto& pos : path) {
-                if (cells[pos.y][pos.x].type != PLAYER &&
-                    cells[pos.y][pos.x].type != TARGET) {
-                    drawPathCell(pos.x, pos.y, pathColor);
-                }
-            }
+        case 'a':
+        case 'A':
+            shownMaze->prepareAutoMove();
+            lastAutoMoveTime = std::chrono::steady_clock::now();
+            pendingSteps = 0;
+            if (shownMaze->isAutoMoving()) startTimer();
+            std::cout << "Start auto-solve" << std::endl;
+            break;
+        case 'w':
+        case 'W': {
+            std::string error;
+            if (saveMaze(*shownMaze, mazeFile.c_str(), error))
+                std::cout << "Saved maze to " << mazeFile << std::endl;
+            else
+                std::cerr << "Cannot save: " << error << std::endl;
+            break;
         }
-
-        glutSwapBuffers();
+        case 'l':
+        case 'L':
+            if (loadMazeFile(*shownMaze, mazeFile)) {
+                restartPrefetch();
+                renderer.fitMaze(*shownMaze);
+                std::cout << "Loaded maze from " << mazeFile << std::endl;
+            }
+            break;
+        case '+':
+        case '=':
+            renderer.zoomAt(1.25f, glutGet(GLUT_WINDOW_WIDTH) / 2.0f, glutGet(GLUT_WINDOW_HEIGHT) / 2.0f);
+            glutPostRedisplay();
+            break;
+        case '-':
+            renderer.zoomAt(0.8f, glutGet(GLUT_WINDOW_WIDTH) / 2.0f, glutGet(GLUT_WINDOW_HEIGHT) / 2.0f);
+            glutPostRedisplay();
+            break;
+        case 'f':
+        case 'F':
+            renderer.fitMaze(*shownMaze);
+            glutPostRedisplay();
+            break;
+        case 'i':
+        case 'I':
+            hudShown = !hudShown;
+            glutPostRedisplay();
+            break;
+        case 27: // ESC
+            exit(0);
     }
+    redisplayIfChanged();
+}
 
-    bool isAutoMoving() const { return autoMoving; }
-
-    static Maze* instance; // Global pointer for GLUT callbacks
-
-private:
-    std::vector<std::vector<Cell>> cells;
-    std::vector<Vector2i> path;
-    std::vector<Vector2i> movePath;
-    Vector2i playerPos;
-    Vector2i targetPos;
-    bool pathFound  = false;
-    bool autoMoving = false;
-    int  currentMoveIndex = 0;
-    std::mt19937 rng;
-
-    std::vector<Vector2i> directions = {
-        Vector2i(1, 0), Vector2i(-1, 0), Vector2i(0, 1), Vector2i(0, -1)
-    };
-
-    void drawCell(int x, int y, const Color& color) {
-        glColor3f(color.r, color.g, color.b);
-        glBegin(GL_QUADS);
-        float x1 = x * CELL_SIZE;
-        float y1 = y * CELL_SIZE;
-        float x2 = x1 + CELL_SIZE - 1;
-        float y2 = y1 + CELL_SIZE - 1;
-
-        glVertex2f(x1, y1);
-        glVertex2f(x2, y1);
-        glVertex2f(x2, y2);
-        glVertex2f(x1, y2);
-        glEnd();
+/* Camera: drag with the left button to pan, wheel (buttons 3 and 4 in
+ * freeglut) to zoom around the cursor */
+int  dragX = 0, dragY = 0;
+bool dragging = false;
+
+void mouse(int button, int state, int x, int y) {
+    if (button == GLUT_LEFT_BUTTON) {
+        dragging = state == GLUT_DOWN;
+        dragX = x;
+        dragY = y;
+    } else if ((button == 3 || button == 4) && state == GLUT_DOWN) {
+        renderer.zoomAt(button == 3 ? 1.25f : 0.8f, float(x), float(y));
+        glutPostRedisplay();
     }
+}
 
-    void drawPathCell(int x, int y, const Color& color) {
-        glColor3f(color.r, color.g, color.b);
-        glBegin(GL_QUADS);
-        float centerX = x * CELL_SIZE + CELL_SIZE / 2.0f;
-        float centerY = y * CELL_SIZE + CELL_SIZE / 2.0f;
-        float halfSize = CELL_SIZE / 4.0f;
-
-        glVertex2f(centerX - halfSize, centerY - halfSize);
-        glVertex2f(centerX + halfSize, centerY - halfSize);
-        glVertex2f(centerX + halfSize, centerY + halfSize);
-        glVertex2f(centerX - halfSize, centerY + halfSize);
-        glEnd();
-    }
+void motion(int x, int y) {
+    if (!dragging) return;
+    renderer.pan(float(x - dragX), float(y - dragY));
+    dragX = x;
+    dragY = y;
+    glutPostRedisplay();
+}
 
-    bool isValidPosition(int x, int y) {
-        return x >= 0 && x < MAZE_WIDTH && y >= 0 && y < MAZE_HEIGHT;
+void reshape(int width, int height) {
+    glViewport(0, 0, width, height);
+    renderer.setViewport(width, height);
+    if (shownMaze) renderer.fitMaze(*shownMaze);
+}
+
+void specialKeys(int key, int x, int y) {
+    if (!shownMaze || shownMaze->isAutoMoving() || shownMaze->isGenerating()) return;
+    if (levelMaze) {
+        int next = shownLevel + (key == GLUT_KEY_PAGE_UP) - (key == GLUT_KEY_PAGE_DOWN);
+        if (next != shownLevel && next >= 0 && next < levelCount(*levelMaze)) {
+            shownLevel = next;
+            showCurrentLevel();
+        }
+        redisplayIfChanged();
+        return;
     }
 
-    void resetVisited() {
-        for (auto& row : cells)
-            for (auto& cell : row)
-                cell.visited = false;
-        path.clear();
-        pathFound = false;
+    switch (key) {
+        case GLUT_KEY_UP:    shownMaze->movePlayer(0, -1); break;
+        case GLUT_KEY_DOWN:  shownMaze->movePlayer(0,  1); break;
+        case GLUT_KEY_LEFT:  shownMaze->movePlayer(-1, 0); break;
+        case GLUT_KEY_RIGHT: shownMaze->movePlayer( 1, 0); break;
     }
+    redisplayIfChanged();
+}
 
-    void reconstructPath(std::unordered_map<int, Vector2i>& parentMap) {
-        Vector2i current = targetPos;
-        while (!(current == playerPos)) {
-            path.push_back(current);
-            current = parentMap[current.y * MAZE_WIDTH + current.x];
+/* The timer only runs while generating progressively or auto-solving, so
+ * an idle window wakes up for input and expose events alone */
+void timer(int value) {
+    if (!shownMaze || !(shownMaze->isGenerating() || shownMaze->isAutoMoving())) {
+        timerRunning = false;
+        return;
+    }
+    if (shownMaze->isGenerating()) {
+        if (shownMaze->continueGeneration(generationBudget * 1000)) {
+            std::cout << "Maze ready" << std::endl;
         }
-        std::reverse(path.begin(), path.end());
+        redisplayIfChanged();
+        glutTimerFunc(16, timer, 0);
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - lastAutoMoveTime).count();
+    lastAutoMoveTime = now;
+
+    /* All steps due since the last tick go out as one frame */
+    size_t steps = SIZE_MAX;
+    if (autoMoveRate > 0) {
+        pendingSteps += elapsed * autoMoveRate;
+        steps = static_cast<size_t>(pendingSteps);
+        pendingSteps -= steps;
     }
+    if (steps) {
+        shownMaze->autoMoveSteps(steps);
+        redisplayIfChanged();
+    }
+    glutTimerFunc(16, timer, 0); // ~60 FPS
+}
 
-    std::vector<Vector2i> getUnvisitedNeighbors(int x, int y) {
-        std::vector<Vector2i> neighbors;
-        const std::vector<Vector2i> dirs = {
-            Vector2i(2, 0), Vector2i(-2, 0), Vector2i(0, 2), Vector2i(0, -2)
-        };
+void startTimer() {
+    if (timerRunning) return;
+    timerRunning = true;
+    glutTimerFunc(16, timer, 0);
+}
 
-        for (const auto& dir : dirs) {
-            int nx = x + dir.x;
-            int ny = y + dir.y;
+struct Options {
+    int width  = DEFAULT_MAZE_WIDTH;
+    int height = DEFAULT_MAZE_HEIGHT;
+    GeneratorType generator = BACKTRACKER;
+    int threads = 1;
+    int levels  = 1;      // stacked levels, more than 1 for a LevelMaze
+    double loops   = 0;   // share of dead ends braided into loops
+    double terrain = 0;   // share of open cells turned to mud or ice
+    SolverType solver = SOLVER_BFS;
+    bool distanceField = false;
+    bool junctionGraph = false;
+    bool gpuField = false; // distance field BFS in a fragment shader
+    RenderMode renderMode = RENDER_BATCHED;
+    bool headless = false;
+    int  count = 100;      // mazes generated and solved in headless mode
+    int  agents = 0;       // random queries solved concurrently on the last maze
+    int  prefetch = 1;     // mazes generated ahead in the background, 0 for none
+    double progressive = 0; // ms of generation per frame instead of prefetching, 0 for off
+    double solveSpeed = 50; // auto-solve cells per second, 0 for instant
+    bool hasSeed = false;
+    uint32_t seed = 0;
+    std::string savePath;
+    std::string loadPath;
+    std::string statsPath; // instrumentation dump written at exit
+};
 
-            if (nx >= 1 && nx < MAZE_WIDTH - 1 &&
-                ny >= 1 && ny < MAZE_HEIGHT - 1 &&
-                !cells[ny][nx].visited) {
-                neighbors.push_back(Vector2i(nx, ny));
+/* Parse the command line; GLUT has already removed its own flags */
+void parseArgs(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        if (!std::strcmp(argv[i], "--size") && i + 1 < argc) {
+            if (std::sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2) {
+                std::cerr << "Invalid --size, expected WxH" << std::endl;
+                exit(1);
+            }
+        } else if (!std::strcmp(argv[i], "--width") && i + 1 < argc) {
+            options.width = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--height") && i + 1 < argc) {
+            options.height = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--algo") && i + 1 < argc) {
+            if (!parseGeneratorName(argv[++i], options.generator)) {
+                std::cerr << "Unknown generator: " << argv[i] << std::endl;
+                exit(1);
+            }
+        } else if (!std::strcmp(argv[i], "--solver") && i + 1 < argc) {
+            if (!parseSolverName(argv[++i], options.solver)) {
+                std::cerr << "Unknown solver: " << argv[i] << std::endl;
+                exit(1);
+            }
+        } else if (!std::strcmp(argv[i], "--headless")) {
+            options.headless = true;
+        } else if (!std::strcmp(argv[i], "--count") && i + 1 < argc) {
+            options.count = std::max(1, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--agents") && i + 1 < argc) {
+            options.agents = std::max(0, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--prefetch") && i + 1 < argc) {
+            options.prefetch = std::max(0, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--progressive") && i + 1 < argc) {
+            options.progressive = std::atof(argv[++i]);
+            if (options.progressive <= 0) {
+                std::cerr << "Invalid --progressive, expected milliseconds per frame" << std::endl;
+                exit(1);
             }
+        } else if (!std::strcmp(argv[i], "--seed") && i + 1 < argc) {
+            options.hasSeed = true;
+            options.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (!std::strcmp(argv[i], "--render-mode") && i + 1 < argc) {
+            if (!parseRenderModeName(argv[++i], options.renderMode)) {
+                std::cerr << "Unknown render mode: " << argv[i] << std::endl;
+                exit(1);
+            }
+        } else if (!std::strcmp(argv[i], "--solve-speed") && i + 1 < argc) {
+            const char* speed = argv[++i];
+            options.solveSpeed = std::strcmp(speed, "instant") ? std::atof(speed) : 0;
+            if (options.solveSpeed < 0 || (options.solveSpeed == 0 && std::strcmp(speed, "instant"))) {
+                std::cerr << "Invalid solve speed: " << speed << std::endl;
+                exit(1);
+            }
+        } else if (!std::strcmp(argv[i], "--save") && i + 1 < argc) {
+            options.savePath = argv[++i];
+        } else if (!std::strcmp(argv[i], "--load") && i + 1 < argc) {
+            options.loadPath = argv[++i];
+        } else if (!std::strcmp(argv[i], "--stats") && i + 1 < argc) {
+            options.statsPath = argv[++i];
+        } else if (!std::strcmp(argv[i], "--distance-field")) {
+            options.distanceField = true;
+        } else if (!std::strcmp(argv[i], "--junction-graph")) {
+            options.junctionGraph = true;
+        } else if (!std::strcmp(argv[i], "--gpu-field")) {
+            options.gpuField = true;
+        } else if (!std::strcmp(argv[i], "--levels") && i + 1 < argc) {
+            options.levels = std::max(1, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--threads") && i + 1 < argc) {
+            options.threads = Maze::clampThreads(std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--loops") && i + 1 < argc) {
+            options.loops = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--terrain") && i + 1 < argc) {
+            options.terrain = std::atof(argv[++i]);
+        } else {
+            std::cerr << "Unknown argument: " << argv[i] << std::endl;
+            exit(1);
         }
-        std::shuffle(neighbors.begin(), neighbors.end(), rng);
-        return neighbors;
     }
-};
+    if (options.levels > 1 &&
+        (options.generator != BACKTRACKER || options.solver != SOLVER_BFS || options.threads > 1 ||
+         options.loops > 0 || options.terrain > 0 || options.agents > 0 || !options.loadPath.empty() ||
+         !options.savePath.empty())) {
+        std::cerr << "--levels supports the back-tracker and BFS only" << std::endl;
+        exit(1);
+    }
+}
 
-Maze* Maze::instance = nullptr;
+double percentile(const std::vector<double>& sorted, double p) {
+    size_t i = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(i, sorted.size() - 1)];
+}
 
-/* Auto-solve animation timer */
-auto lastAutoMoveTime = std::chrono::steady_clock::now();
-const float autoMoveInterval = 0.02f; // 20 ms
+/* FNV-1a over the cell types, to compare mazes between runs and machines */
+uint64_t mazeFingerprint(const Maze& maze) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (int y = 0; y < maze.getHeight(); y++) {
+        for (int x = 0; x < maze.getWidth(); x++) {
+            hash = (hash ^ (maze.cellType(x, y) == WALL ? 0 : 1)) * 1099511628211ULL;
+        }
+    }
+    return hash;
+}
 
-/* GLUT callback functions */
-void display() {
-    if (Maze::instance) Maze::instance->draw();
+/* Headless run over a saved maze: map it and solve it in place */
+int runHeadlessLoaded(const Options& options) {
+    auto start = std::chrono::steady_clock::now();
+    MappedFile file;
+    PackedMaze packed;
+    std::string error;
+    if (!file.open(options.loadPath.c_str(), error) || !packed.open(file.data(), file.size(), error)) {
+        std::cerr << "Cannot load " << options.loadPath << ": " << error << std::endl;
+        return 1;
+    }
+    double openMicros = std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - start).count();
+
+    PackedSolver solver;
+    Vector2i from(1, 1), to(packed.getWidth() - 2, packed.getHeight() - 2);
+    std::vector<double> solveMicros;
+    solveMicros.reserve(options.count);
+    bool solved = true;
+    for (int i = 0; i < options.count; i++) {
+        auto t0 = std::chrono::steady_clock::now();
+        solved = solver.solve(packed, from, to);
+        solveMicros.push_back(std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - t0).count());
+    }
+    std::sort(solveMicros.begin(), solveMicros.end());
+
+    std::printf("%s: %dx%d (%s, seed %u #%u), %zu bytes\n", options.loadPath.c_str(),
+                packed.getWidth(), packed.getHeight(), generatorName(packed.getGenerator()),
+                packed.getSeed(), packed.getSequence(), file.size());
+    std::printf("  open        %.1f us\n", openMicros);
+    std::printf("  solve (us)  p50 %.1f  p90 %.1f  p99 %.1f  max %.1f  (%d runs, packed BFS)\n",
+                percentile(solveMicros, 0.50), percentile(solveMicros, 0.90),
+                percentile(solveMicros, 0.99), solveMicros.back(), options.count);
+    if (!solved) {
+        std::printf("  no path\n");
+        return 1;
+    }
+    std::printf("  path        %zu cells, %zu rooms expanded\n", solver.getPath().size(),
+                solver.cellsExpanded());
+    return 0;
 }
 
-void keyboard(unsigned char key, int x, int y) {
-    if (!Maze::instance) return;
+/* FNV-1a over every level, like mazeFingerprint() */
+uint64_t levelFingerprint(const LevelMaze& maze) {
+    uint64_t hash = 14695981039346656037ULL;
+    Vector3i size = maze.getSize();
+    for (int z = 0; z < size.z; z++) {
+        for (int y = 0; y < size.y; y++) {
+            for (int x = 0; x < size.x; x++) {
+                hash = (hash ^ (maze.cellType(Vector3i(x, y, z)) == WALL ? 0 : 1)) * 1099511628211ULL;
+            }
+        }
+    }
+    return hash;
+}
 
-    switch (key) {
-        case ' ': // Space
-            Maze::instance->findPathBFS();
-            std::cout << "Show shortest path" << std::endl;
-            break;
-        case 'r':
-        case 'R':
-            Maze::instance->reset();
-            std::cout << "Reset maze" << std::endl;
-            break;
-        case 'n':
-        case 'N':
-            Maze::instance->generateNewMaze();
-            std::cout << "Generate new maze" << std::endl;
-            break;
-        case 'a':
-        case 'A':
-            Maze::instance->prepareAutoMove();
-            lastAutoMoveTime = std::chrono::steady_clock::now();
-            std::cout << "Start auto-solve" << std::endl;
-            break;
-        case 27: // ESC
-            exit(0);
+/* Headless run over multi-level mazes */
+int runHeadlessLevels(const Options& options) {
+    uint32_t seed = options.hasSeed ? options.seed : static_cast<uint32_t>(std::time(nullptr));
+    LevelMaze maze(Vector3i(options.width, options.height, 2 * options.levels + 1), seed);
+    LevelScratch scratch;
+    std::vector<Vector3i> path;
+    SolveStats stats;
+
+    std::vector<double> generateMicros, solveMicros;
+    generateMicros.reserve(options.count);
+    solveMicros.reserve(options.count);
+    size_t unsolved = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < options.count; i++) {
+        auto t0 = std::chrono::steady_clock::now();
+        maze.generate();
+        auto t1 = std::chrono::steady_clock::now();
+        if (!maze.solve(maze.getStart(), maze.getTarget(), scratch, path, stats)) unsolved++;
+        auto t2 = std::chrono::steady_clock::now();
+
+        generateMicros.push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+        solveMicros.push_back(std::chrono::duration<double, std::micro>(t2 - t1).count());
     }
-    glutPostRedisplay();
+    double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double generateTotal = 0;
+    for (double us : generateMicros) generateTotal += us;
+    std::sort(solveMicros.begin(), solveMicros.end());
+    Vector3i size = maze.getSize();
+    double cells = double(maze.cellCount());
+    size_t stairs = 0; // stairwell cells, one per change of level
+    for (const Vector3i& p : path) stairs += p.z % 2 == 0;
+
+    std::printf("%d mazes of %dx%d, %d levels (backtracker, bfs solver, seed %u)\n", options.count,
+                size.x, size.y, levelCount(maze), seed);
+    std::printf("  total       %.3f s, %.1f mazes/s\n", total, options.count / total);
+    std::printf("  generate    %.1f us/maze, %.2f Mcells/s\n",
+                generateTotal / options.count, cells * options.count / generateTotal);
+    std::printf("  solve (us)  p50 %.1f  p90 %.1f  p99 %.1f  max %.1f\n",
+                percentile(solveMicros, 0.50), percentile(solveMicros, 0.90),
+                percentile(solveMicros, 0.99), solveMicros.back());
+    std::printf("  last maze   fingerprint %016llx, path %zu cells, %zu stairwells\n",
+                static_cast<unsigned long long>(levelFingerprint(maze)), path.size(), stairs);
+    if (unsolved) std::printf("  %zu mazes had no path\n", unsolved);
+    return unsolved ? 1 : 0;
 }
 
-void specialKeys(int key, int x, int y) {
-    if (!Maze::instance || Maze::instance->isAutoMoving()) return;
+/* Generate and solve options.count mazes back to back without creating a
+ * window, then print throughput and solve latency percentiles */
+int runHeadless(const Options& options) {
+    if (!options.loadPath.empty()) return runHeadlessLoaded(options);
+    if (options.levels > 1) return runHeadlessLevels(options);
+    uint32_t seed = options.hasSeed ? options.seed : static_cast<uint32_t>(std::time(nullptr));
+    Maze maze(options.width, options.height, options.generator, options.threads, seed, options.loops,
+              options.terrain);
+    maze.setSolver(options.solver);
+    maze.setDistanceFieldEnabled(options.distanceField);
+    maze.setJunctionGraphEnabled(options.junctionGraph);
+    if (options.gpuField) std::cout << "--gpu-field needs a window, distance field on the CPU" << std::endl;
+
+    std::vector<double> generateMicros, solveMicros;
+    generateMicros.reserve(options.count);
+    solveMicros.reserve(options.count);
+    size_t unsolved = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < options.count; i++) {
+        auto t0 = std::chrono::steady_clock::now();
+        maze.generateNewMaze();
+        auto t1 = std::chrono::steady_clock::now();
+        maze.findPath();
+        auto t2 = std::chrono::steady_clock::now();
+
+        generateMicros.push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+        solveMicros.push_back(std::chrono::duration<double, std::micro>(t2 - t1).count());
+        if (!maze.hasPath()) unsolved++;
+    }
+    double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double generateTotal = 0;
+    for (double us : generateMicros) generateTotal += us;
+    std::sort(solveMicros.begin(), solveMicros.end());
+    double cells = double(maze.getWidth()) * maze.getHeight();
+
+    std::printf("%d mazes of %dx%d (%s, %s solver, seed %u)\n", options.count,
+                maze.getWidth(), maze.getHeight(), generatorName(options.generator),
+                solverName(options.solver), seed);
+    std::printf("  total       %.3f s, %.1f mazes/s\n", total, options.count / total);
+    std::printf("  generate    %.1f us/maze, %.2f Mcells/s\n",
+                generateTotal / options.count, cells * options.count / generateTotal);
+    std::printf("  solve (us)  p50 %.1f  p90 %.1f  p99 %.1f  max %.1f\n",
+                percentile(solveMicros, 0.50), percentile(solveMicros, 0.90),
+                percentile(solveMicros, 0.99), solveMicros.back());
+    std::printf("  last maze   fingerprint %016llx, path %zu cells, cost %llu\n",
+                static_cast<unsigned long long>(mazeFingerprint(maze)), maze.getPath().size(),
+                static_cast<unsigned long long>(maze.getLastSolveStats().pathCost));
+    if (unsolved) std::printf("  %zu mazes had no path\n", unsolved);
+    if (maze.hasJunctionGraph()) {
+        const JunctionGraph& graph = maze.getJunctionGraph();
+        std::printf("  graph       %u nodes, %zu edges, %.1f KB (%.1f KB of cells)\n",
+                    graph.nodeCount(), graph.edges.size(), graph.memoryBytes() / 1024.0, cells / 1024.0);
+    }
 
-    switch (key) {
-        case GLUT_KEY_UP:    Maze::instance->movePlayer(0, -1); break;
-        case GLUT_KEY_DOWN:  Maze::instance->movePlayer(0,  1); break;
-        case GLUT_KEY_LEFT:  Maze::instance->movePlayer(-1, 0); break;
-        case GLUT_KEY_RIGHT: Maze::instance->movePlayer( 1, 0); break;
+    if (options.agents) {
+        Pcg32 rng(seed, 1);
+        std::vector<AgentQuery> queries = randomAgentQueries(maze, options.agents, rng);
+        std::vector<AgentResult> results;
+        AgentSolver agents(options.threads);
+        auto t0 = std::chrono::steady_clock::now();
+        agents.solve(maze, options.solver, queries, results);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        std::printf("  agents      %d queries on %d threads in %.3f s, %.0f queries/s\n",
+                    options.agents, agents.getThreads(), seconds, options.agents / seconds);
     }
-    glutPostRedisplay();
+
+    std::string error;
+    if (!options.savePath.empty() && !saveMaze(maze, options.savePath.c_str(), error)) {
+        std::cerr << "Cannot save: " << error << std::endl;
+        return 1;
+    }
+    return unsolved ? 1 : 0;
 }
 
-void timer(int value) {
-    if (Maze::instance && Maze::instance->isAutoMoving()) {
-        auto now = std::chrono::steady_clock::now();
-        auto elapsed = std::chrono::duration<float>(now - lastAutoMoveTime).count();
+/* --stats file, written however the program ends (ESC, closing the window
+ * or the end of a headless run) */
+std::string statsPath;
 
-        if (elapsed >= autoMoveInterval) {
-            Maze::instance->autoMoveStep();
-            lastAutoMoveTime = now;
-            glutPostRedisplay();
-        }
-    }
-    glutTimerFunc(16, timer, 0); // ~60 FPS
+void writeStatsAtExit() {
+    std::string error;
+    if (!writeStats(statsPath.c_str(), error)) std::cerr << "Cannot write stats: " << error << std::endl;
+}
+
+void writeStatsOnExit(const std::string& path) {
+    if (path.empty()) return;
+    statsPath = path;
+    std::atexit(writeStatsAtExit);
 }
 
 int main(int argc, char** argv) {
+    Options options;
+    bool headless = false;
+    for (int i = 1; i < argc; i++) {
+        if (!std::strcmp(argv[i], "--headless")) headless = true;
+    }
+    if (headless) {
+        parseArgs(argc, argv, options);
+        writeStatsOnExit(options.statsPath);
+        return runHeadless(options);
+    }
+
     glutInit(&argc, argv);
+    parseArgs(argc, argv, options);
+    writeStatsOnExit(options.statsPath);
+    uint32_t seed = options.hasSeed ? options.seed : static_cast<uint32_t>(std::time(nullptr));
+    bool loading = !options.loadPath.empty();
+    bool small = loading || options.levels > 1; // replaced right away
+    Maze maze(small ? 5 : options.width, small ? 5 : options.height,
+              options.generator, options.threads, seed, options.loops, options.terrain);
+    if (loading && !loadMazeFile(maze, options.loadPath)) return 1;
+    maze.setSolver(options.solver);
+    maze.setDistanceFieldEnabled(options.distanceField);
+    maze.setJunctionGraphEnabled(options.junctionGraph);
+    shownMaze = &maze;
+    LevelMaze levels(options.levels > 1 ? Vector3i(options.width, options.height, 2 * options.levels + 1)
+                                        : Vector3i(), seed);
+    if (options.levels > 1) {
+        levelMaze = &levels;
+        showCurrentLevel();
+    }
+    MazePrefetcher background(options.prefetch);
+    generationBudget = levelMaze ? 0 : options.progressive;
+    if (!levelMaze && options.prefetch > 0 && generationBudget == 0) {
+        prefetcher = &background;
+        prefetcher->restart(maze);
+    }
+    if (!options.savePath.empty())      mazeFile = options.savePath;
+    else if (!options.loadPath.empty()) mazeFile = options.loadPath;
+    int width  = maze.getWidth();
+    int height = maze.getHeight();
+
+    /* The window keeps the maze's aspect ratio up to MAX_WINDOW_SIZE; the
+     * camera fits the maze into it and zooms from there */
+    float scale = float(MAX_WINDOW_SIZE) / std::max(width, height);
+    int windowWidth  = std::max(200, int(std::min<float>(MAX_CELL_SIZE, scale) * width));
+    int windowHeight = std::max(200, int(std::min<float>(MAX_CELL_SIZE, scale) * height));
+    renderer.setMode(options.renderMode);
+    autoMoveRate = options.solveSpeed;
+
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
-    glutInitWindowSize(CELL_SIZE * MAZE_WIDTH, CELL_SIZE * MAZE_HEIGHT);
+    glutInitWindowSize(windowWidth, windowHeight);
     glutCreateWindow("Random Maze Generator (Pure OpenGL)");
 
-    glViewport(0, 0, CELL_SIZE * MAZE_WIDTH, CELL_SIZE * MAZE_HEIGHT);
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    glOrtho(0, CELL_SIZE * MAZE_WIDTH, CELL_SIZE * MAZE_HEIGHT, 0, -1, 1);
+    glViewport(0, 0, windowWidth, windowHeight);
     glMatrixMode(GL_MODELVIEW);
     glLoadIdentity();
     glClearColor(0.16f, 0.16f, 0.16f, 1.0f);
 
-    Maze maze;
-    Maze::instance = &maze;
+    renderer.setViewport(windowWidth, windowHeight);
+    renderer.fitMaze(maze);
+    if (options.gpuField) {
+        if (gpuField.available()) {
+            fieldBackend = &gpuField;
+            maze.setDistanceFieldBackend(fieldBackend);
+            std::cout << "Distance field on the GPU" << std::endl;
+        } else {
+            std::cout << "No OpenGL 2.0 / framebuffer objects, distance field on the CPU" << std::endl;
+        }
+    }
 
     glutDisplayFunc(display);
     glutKeyboardFunc(keyboard);
     glutSpecialFunc(specialKeys);
-    glutTimerFunc(0, timer, 0);
+    glutMouseFunc(mouse);
+    glutMotionFunc(motion);
+    glutReshapeFunc(reshape);
 
     std::cout << "Maze controls:" << std::endl;
     std::cout << "Arrow keys - move player" << std::endl;
     std::cout << "Space      - show shortest path" << std::endl;
+    std::cout << "S          - next solver (BFS / bidirectional / A* / field / bitboard / Dijkstra / graph)" << std::endl;
+    std::cout << "H          - toggle distance heat map" << std::endl;
+    std::cout << "M          - next render mode" << std::endl;
     std::cout << "R          - reset maze" << std::endl;
-    std::cout << "N          - generate new maze" << std::endl;
+    std::cout << "N          - next maze (prefetched in the background)" << std::endl;
+    std::cout << "G          - next generator algorithm" << std::endl;
     std::cout << "A          - auto-solve" << std::endl;
+    std::cout << "+ / -      - zoom (or mouse wheel), drag to pan" << std::endl;
+    std::cout << "F          - fit maze to window" << std::endl;
+    std::cout << "W / L      - save / load " << mazeFile << std::endl;
+    std::cout << "I          - toggle instrumentation HUD" << std::endl;
+    if (levelMaze) std::cout << "Page up/dn - show the level above / below" << std::endl;
     std::cout << "ESC        - quit" << std::endl;
 
     glutMainLoop();
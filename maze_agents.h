@@ -0,0 +1,63 @@
+/*
+ * Many agents solving paths on one maze at once.
+ *
+ * Maze::solve() only reads the maze and keeps its working memory in a
+ * SolverScratch, so a batch of queries can be spread over a thread pool
+ * with one scratch per worker.  The maze must not be modified (generated,
+ * reset, player moved) while a batch is running.
+ */
+
+#ifndef MAZE_AGENTS_H
+#define MAZE_AGENTS_H
+
+#include "maze_core.h"
+
+/* One agent's request: a path between two open cells */
+struct AgentQuery {
+    Vector2i from, to;
+};
+
+struct AgentResult {
+    bool found = false;
+    std::vector<Vector2i> path;  // target first, without `from`, as Maze::getPath()
+    SolveStats stats;
+};
+
+/* Solves batches of agent queries on a thread pool.  Results keep their
+ * path storage between batches of the same size. */
+class AgentSolver {
+public:
+    explicit AgentSolver(int threads) : pool(threads), scratch(pool.size()) {}
+
+    int getThreads() const { return pool.size(); }
+
+    void solve(const Maze& maze, SolverType solver, const std::vector<AgentQuery>& queries,
+               std::vector<AgentResult>& results) {
+        results.resize(queries.size());
+        pool.run(queries.size(), [&](size_t i, int worker) {
+            AgentResult& result = results[i];
+            result.found = maze.solve(solver, queries[i].from, queries[i].to, scratch[worker],
+                                      result.path, result.stats);
+        });
+    }
+
+private:
+    ThreadPool pool;
+    std::vector<SolverScratch> scratch;  // one per worker
+};
+
+/* `count` queries between random rooms (odd coordinates) of the maze */
+inline std::vector<AgentQuery> randomAgentQueries(const Maze& maze, size_t count, Pcg32& rng) {
+    uint32_t roomsWide = (maze.getWidth() - 1) / 2, roomsHigh = (maze.getHeight() - 1) / 2;
+    auto randomRoom = [&]() {
+        return Vector2i(2 * int(rng.below(roomsWide)) + 1, 2 * int(rng.below(roomsHigh)) + 1);
+    };
+    std::vector<AgentQuery> queries(count);
+    for (auto& query : queries) {
+        query.from = randomRoom();
+        query.to   = randomRoom();
+    }
+    return queries;
+}
+
+#endif // MAZE_AGENTS_H
@@ -0,0 +1,77 @@
+/*
+ * Replacement global operator new and delete that count every heap
+ * allocation of the process in allocationCount() (maze_stats.h), for the
+ * app's HUD and --stats and the bench's allocs/op.  Programs that want the
+ * counts link this file; the library and the server do not.
+ *
+ * All the replaceable forms (scalar, array, nothrow and, from C++17,
+ * over-aligned) are replaced, so none bypasses the counter or pairs with
+ * the library's delete.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#include "maze_stats.h"
+
+/* The deletes free out of line: GCC inlines them into callers it sees
+ * allocate with the built-in operator new (with LTO, across files) and
+ * then reports a free() of new'd memory (-Wmismatched-new-delete) */
+#ifdef _MSC_VER
+#define MAZE_NOINLINE __declspec(noinline)
+#else
+#define MAZE_NOINLINE __attribute__((noinline))
+#endif
+
+static void* countedAlloc(size_t size) noexcept {
+    allocationCount()++;
+    return std::malloc(size ? size : 1);
+}
+void* operator new(size_t size) {
+    if (void* p = countedAlloc(size)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+static MAZE_NOINLINE void releaseBlock(void* p) noexcept { std::free(p); }
+void operator delete(void* p) noexcept { releaseBlock(p); }
+void operator delete[](void* p) noexcept { releaseBlock(p); }
+void operator delete(void* p, size_t) noexcept { releaseBlock(p); }
+void operator delete[](void* p, size_t) noexcept { releaseBlock(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { releaseBlock(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { releaseBlock(p); }
+#ifdef __cpp_aligned_new
+/* Over-aligned blocks keep the pointer malloc returned just below them */
+static void* countedAlignedAlloc(size_t size, std::align_val_t align) noexcept {
+    size_t alignment = std::max(size_t(align), sizeof(void*));
+    void* block = countedAlloc(size + alignment + sizeof(void*));
+    if (!block) return nullptr;
+    uintptr_t aligned = (reinterpret_cast<uintptr_t>(block) + sizeof(void*) + alignment - 1) &
+                        ~uintptr_t(alignment - 1);
+    reinterpret_cast<void**>(aligned)[-1] = block;
+    return reinterpret_cast<void*>(aligned);
+}
+static MAZE_NOINLINE void countedAlignedFree(void* p) noexcept {
+    if (p) releaseBlock(static_cast<void**>(p)[-1]);
+}
+void* operator new(size_t size, std::align_val_t align) {
+    if (void* p = countedAlignedAlloc(size, align)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size, std::align_val_t align) { return operator new(size, align); }
+void* operator new(size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    return countedAlignedAlloc(size, align);
+}
+void* operator new[](size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    return countedAlignedAlloc(size, align);
+}
+void operator delete(void* p, std::align_val_t) noexcept { countedAlignedFree(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { countedAlignedFree(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { countedAlignedFree(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { countedAlignedFree(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { countedAlignedFree(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { countedAlignedFree(p); }
+#endif
@@ -0,0 +1,199 @@
+/*
+ * The C interface of maze_api.h over Maze and the packed formats of
+ * maze_file.h.  No exception crosses the boundary: every entry point that
+ * can throw runs through guarded(), which turns std::bad_alloc into
+ * MAZE_ERROR_MEMORY and anything else into MAZE_ERROR_INTERNAL.
+ */
+
+/* No hot-path table: handles are used from many threads at once */
+#define MAZE_STATS 0
+
+#include "maze_api.h"
+
+#include <memory>
+#include <new>
+
+#include "maze_core.h"
+#include "maze_file.h"
+
+struct maze_t {
+    Maze maze;
+    std::vector<uint8_t> packed;
+    uint64_t packedVersion = 0; // maze version the packed bytes show, 0 for none
+
+    maze_t(int width, int height, GeneratorType generator, uint32_t seed)
+        : maze(width, height, generator, 1, seed) {}
+};
+
+struct maze_solver_t {
+    SolverScratch scratch;
+    SolveStats stats;
+    std::vector<Vector2i> path;  // as Maze::getPath()
+    std::vector<int32_t> cells;  // x, y pairs in walking order
+    std::vector<uint8_t> packed; // packPath() of the path
+};
+
+namespace {
+
+const int MAX_EXTENT = 1 << 20; // as PackedMaze accepts
+
+/* Checked on the sides Maze will have, rounded up to odd, so every maze
+ * made here can be packed and read back */
+bool validSize(int width, int height) {
+    return width > 0 && height > 0 && Maze::normalizeSize(width) <= MAX_EXTENT &&
+           Maze::normalizeSize(height) <= MAX_EXTENT;
+}
+
+template <typename Body>
+maze_status guarded(Body&& body) {
+    try {
+        return body();
+    } catch (const std::bad_alloc&) {
+        return MAZE_ERROR_MEMORY;
+    } catch (...) {
+        return MAZE_ERROR_INTERNAL;
+    }
+}
+
+}
+
+extern "C" {
+
+int maze_api_version(void) { return MAZE_API_VERSION; }
+
+const char* maze_status_name(maze_status status) {
+    switch (status) {
+        case MAZE_OK:             return "ok";
+        case MAZE_ERROR_ARGUMENT: return "invalid argument";
+        case MAZE_ERROR_FORMAT:   return "not a packed maze";
+        case MAZE_ERROR_NO_PATH:  return "no path";
+        case MAZE_ERROR_MEMORY:   return "out of memory";
+        case MAZE_ERROR_INTERNAL: return "internal error";
+        default:                  return "unknown status";
+    }
+}
+
+maze_status maze_create(int width, int height, const char* generator, uint32_t seed, maze_t** out) {
+    if (!out) return MAZE_ERROR_ARGUMENT;
+    *out = nullptr;
+    GeneratorType type = BACKTRACKER;
+    if (!validSize(width, height) || (generator && !parseGeneratorName(generator, type))) {
+        return MAZE_ERROR_ARGUMENT;
+    }
+    return guarded([&]() {
+        *out = new maze_t(width, height, type, seed);
+        return MAZE_OK;
+    });
+}
+
+maze_status maze_create_packed(const uint8_t* data, size_t size, maze_t** out) {
+    if (!out || !data) return MAZE_ERROR_ARGUMENT;
+    *out = nullptr;
+    return guarded([&]() {
+        /* open() checks every header field loadMaze() uses, the thread
+         * count and the braid and terrain fractions included */
+        PackedMaze packed;
+        std::string error;
+        if (!packed.open(data, size, error)) return MAZE_ERROR_FORMAT;
+        std::unique_ptr<maze_t> handle(new maze_t(5, 5, packed.getGenerator(), packed.getSeed()));
+        loadMaze(handle->maze, packed);
+        *out = handle.release();
+        return MAZE_OK;
+    });
+}
+
+void maze_destroy(maze_t* maze) { delete maze; }
+
+maze_status maze_generate_next(maze_t* maze) {
+    if (!maze) return MAZE_ERROR_ARGUMENT;
+    return guarded([&]() {
+        maze->maze.generateNewMaze();
+        return MAZE_OK;
+    });
+}
+
+int maze_width(const maze_t* maze) { return maze ? maze->maze.getWidth() : 0; }
+int maze_height(const maze_t* maze) { return maze ? maze->maze.getHeight() : 0; }
+
+int maze_is_open(const maze_t* maze, int x, int y) {
+    if (!maze || x < 0 || y < 0 || x >= maze->maze.getWidth() || y >= maze->maze.getHeight()) return 0;
+    return maze->maze.cellType(x, y) != WALL;
+}
+
+maze_status maze_pack(maze_t* maze, const uint8_t** data, size_t* size) {
+    if (!maze || !data || !size) return MAZE_ERROR_ARGUMENT;
+    if (maze->packedVersion != maze->maze.getVersion()) {
+        maze->packedVersion = 0;
+        maze_status status = guarded([&]() {
+            packMaze(maze->maze, maze->packed);
+            return MAZE_OK;
+        });
+        if (status != MAZE_OK) return status;
+        maze->packedVersion = maze->maze.getVersion();
+    }
+    *data = maze->packed.data();
+    *size = maze->packed.size();
+    return MAZE_OK;
+}
+
+maze_status maze_solver_create(maze_solver_t** out) {
+    if (!out) return MAZE_ERROR_ARGUMENT;
+    *out = nullptr;
+    return guarded([&]() {
+        *out = new maze_solver_t();
+        return MAZE_OK;
+    });
+}
+
+void maze_solver_destroy(maze_solver_t* solver) { delete solver; }
+
+maze_status maze_solve(const maze_t* maze, maze_solver_t* solver, const char* algorithm,
+                       int fromX, int fromY, int toX, int toY) {
+    if (!maze || !solver) return MAZE_ERROR_ARGUMENT;
+    SolverType type = SOLVER_BFS;
+    /* Handles never build a distance field or junction graph */
+    if (algorithm && (!parseSolverName(algorithm, type) || Maze::usesPrecomputed(type))) {
+        return MAZE_ERROR_ARGUMENT;
+    }
+    solver->cells.clear();
+    solver->packed.clear();
+    Vector2i from(fromX, fromY), to(toX, toY);
+    maze_status status = guarded([&]() {
+        if (!maze->maze.solve(type, from, to, solver->scratch, solver->path, solver->stats)) {
+            return maze_is_open(maze, fromX, fromY) && maze_is_open(maze, toX, toY)
+                       ? MAZE_ERROR_NO_PATH : MAZE_ERROR_ARGUMENT;
+        }
+        solver->cells.reserve(2 * solver->path.size());
+        for (size_t k = solver->path.size(); k-- > 0;) {
+            solver->cells.push_back(solver->path[k].x);
+            solver->cells.push_back(solver->path[k].y);
+        }
+        packPath(from, solver->path, solver->packed);
+        return MAZE_OK;
+    });
+    if (status != MAZE_OK) {
+        solver->path.clear();
+        solver->cells.clear();
+        solver->packed.clear();
+    }
+    return status;
+}
+
+size_t maze_path_length(const maze_solver_t* solver) { return solver ? solver->path.size() : 0; }
+
+const int32_t* maze_path_cells(const maze_solver_t* solver) {
+    return solver && !solver->cells.empty() ? solver->cells.data() : nullptr;
+}
+
+maze_status maze_path_pack(const maze_solver_t* solver, const uint8_t** data, size_t* size) {
+    if (!solver || !data || !size) return MAZE_ERROR_ARGUMENT;
+    *data = solver->packed.data();
+    *size = solver->packed.size();
+    return MAZE_OK;
+}
+
+size_t maze_path_cells_expanded(const maze_solver_t* solver) {
+    return solver ? solver->stats.cellsExpanded : 0;
+}
+
+}
@@ -0,0 +1,95 @@
+/*
+ * C interface to the maze library.
+ *
+ * maze_api.cc wraps maze_core.h and maze_file.h (no GL, no global state)
+ * behind opaque handles, so the generator and solvers can be linked into
+ * other programs and languages as a static or shared library:
+ *
+ *   g++ -O2 -std=c++14 -fPIC -shared maze_api.cc -pthread -o libmaze.so
+ *
+ * Functions return MAZE_OK or an error status.  Handles are independent:
+ * different mazes and solvers can be used from different threads at once,
+ * and one maze can be solved from many threads as long as each has its
+ * own maze_solver_t and nobody generates or packs it meanwhile.  Buffers
+ * handed out (packed mazes, paths) belong to the handle and stay valid
+ * until its next call that changes them or its destruction, so nothing
+ * is copied on the way out.
+ *
+ * Packed mazes use the file format of maze_file.h; packed paths store the
+ * direction of each step from the start (0 east, 1 west, 2 south, 3 north)
+ * in 2 bits, four steps to a byte from the low bits.
+ */
+
+#ifndef MAZE_API_H
+#define MAZE_API_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bumped whenever a declaration below changes incompatibly */
+#define MAZE_API_VERSION 1
+
+typedef enum maze_status {
+    MAZE_OK = 0,
+    MAZE_ERROR_ARGUMENT,  /* bad handle, size, name or position */
+    MAZE_ERROR_FORMAT,    /* not a valid packed maze */
+    MAZE_ERROR_NO_PATH,   /* the positions are not connected */
+    MAZE_ERROR_MEMORY,
+    MAZE_ERROR_INTERNAL   /* any other failure inside the library */
+} maze_status;
+
+typedef struct maze_t maze_t;
+typedef struct maze_solver_t maze_solver_t;
+
+int maze_api_version(void);
+const char* maze_status_name(maze_status status);
+
+/* Generate a width x height maze (rounded up to odd, at least 5) with the
+ * named generator ("backtracker", "binary-tree", "sidewinder", "eller";
+ * NULL for the back-tracker).  The same seed gives the same mazes on
+ * every platform, like the app's --seed. */
+maze_status maze_create(int width, int height, const char* generator, uint32_t seed, maze_t** out);
+/* Rebuild a maze from packed bytes, e.g. from maze_pack() or a .mz file.
+ * maze_generate_next() then continues the packed maze's seed from the RNG
+ * position stored with it. */
+maze_status maze_create_packed(const uint8_t* data, size_t size, maze_t** out);
+void maze_destroy(maze_t* maze);
+
+/* Replace the maze with the next one of its seed's sequence */
+maze_status maze_generate_next(maze_t* maze);
+
+int maze_width(const maze_t* maze);
+int maze_height(const maze_t* maze);
+/* 1 when cell (x, y) is open, 0 for walls and positions outside */
+int maze_is_open(const maze_t* maze, int x, int y);
+
+/* The maze in the packed format; *data stays valid until the maze
+ * changes or is destroyed */
+maze_status maze_pack(maze_t* maze, const uint8_t** data, size_t* size);
+
+maze_status maze_solver_create(maze_solver_t** out);
+void maze_solver_destroy(maze_solver_t* solver);
+
+/* Find a path from (fromX, fromY) to (toX, toY) with the named solver:
+ * "bfs" (or NULL), "bidirectional", "astar", "bitboard" or "dijkstra".
+ * "field", "graph" and "graph-astar" need a distance field or junction
+ * graph, which handles do not build, and give MAZE_ERROR_ARGUMENT. */
+maze_status maze_solve(const maze_t* maze, maze_solver_t* solver, const char* algorithm,
+                       int fromX, int fromY, int toX, int toY);
+/* The last path found: `length` cells from the first step to the goal,
+ * as x, y pairs in walking order, and its packed steps */
+size_t maze_path_length(const maze_solver_t* solver);
+const int32_t* maze_path_cells(const maze_solver_t* solver);
+maze_status maze_path_pack(const maze_solver_t* solver, const uint8_t** data, size_t* size);
+/* Cells expanded by the last solve */
+size_t maze_path_cells_expanded(const maze_solver_t* solver);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MAZE_API_H */
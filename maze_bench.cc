@@ -0,0 +1,510 @@
+/*
+ * Maze benchmarks
+ *
+ * Times the hot paths of Maze across a matrix of maze sizes and seeds and
+ * reports the median and p99 time per operation together with the number
+ * of heap allocations each operation made once warmed up:
+ *
+ *  generate     Maze::generateMaze with the selected generator
+ *  tiled/N      parallel back-tracking on N threads (largest size only)
+ *  agents/N     a batch of BFS queries between random rooms solved on N
+ *               threads with AgentSolver (largest size up to 2049)
+ *  bfs, ...     Maze::findPath with each solver; the bitboard solver's
+ *               speed-up over bfs is printed below it
+ *  reconstruct  Maze::reconstructPath after a BFS
+ *  junctions    Maze::buildJunctionGraph, which the graph solvers search
+ *  draw/MODE    MazeRenderer::draw of a fresh maze per render mode (only
+ *               with --render, needs a display)
+ *  redraw/MODE  MazeRenderer::draw after a single player move
+ *  field/cpu    Maze::buildDistanceField on the CPU and, with --render,
+ *  field/gpu    on GpuDistanceField (one fragment-shader pass per step of
+ *               the wavefront, so mind the size on a software rasterizer)
+ *  layouts      generate, bfs and astar on the largest size for each cell
+ *               layout of maze_layout.h, with hardware cache misses per
+ *               operation where perf events are available (Linux)
+ *  levels/...   LevelMaze from maze_levels.h: back-tracking and BFS on 4
+ *               stacked levels next to Maze's own on one (largest size
+ *               up to 2049)
+ *
+ * Before timing it checks that A*, Dijkstra and graph A* agree on path
+ * costs over mud and ice, under the player too, and exits with 1 if not.
+ *
+ * Options:
+ *  --sizes a,b,c   maze sizes to run (default 21,129,513,2049,8193)
+ *  --seeds N       seeds per size (default 2)
+ *  --reps N        repetitions per seed (default: scaled by maze size)
+ *  --algo NAME     generator to benchmark (default backtracker)
+ *  --loops F       braid that share of dead ends into loops (default 0)
+ *  --terrain F     turn that share of open cells into mud or ice (default 0)
+ *  --render        also time the renderer
+ */
+
+/* maze_render.h picks the GL headers (and their extension prototypes), so
+ * it has to come before GLUT */
+#include "maze_render.h"
+
+#ifdef __APPLE__
+#include <GLUT/glut.h>
+#else
+#include <GL/glut.h>
+#endif
+#include <atomic>
+#include <cstdio>
+#include <new>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "maze_agents.h"
+#include "maze_core.h"
+#include "maze_gpu.h"
+#include "maze_levels.h"
+
+struct Sample {
+    std::vector<double> micros;
+    size_t allocations = 0;
+    size_t runs = 0;
+};
+
+double percentile(std::vector<double> values, double p) {
+    std::sort(values.begin(), values.end());
+    size_t i = static_cast<size_t>(p * (values.size() - 1) + 0.5);
+    return values[std::min(i, values.size() - 1)];
+}
+
+template <typename F>
+void measure(Sample& sample, F&& operation) {
+    size_t before = allocationCount().load();
+    auto start = std::chrono::steady_clock::now();
+    operation();
+    auto end = std::chrono::steady_clock::now();
+    sample.allocations += allocationCount().load() - before;
+    sample.runs++;
+    sample.micros.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+}
+
+void report(const char* operation, int size, const Sample& sample) {
+    if (sample.micros.empty()) return;
+    std::printf("%-14s %6d  %12.1f  %12.1f  %10.2f\n", operation, size,
+                percentile(sample.micros, 0.50), percentile(sample.micros, 0.99),
+                double(sample.allocations) / sample.runs);
+}
+
+/* Last-level and L1 data cache misses of the calling thread, counted by
+ * perf events.  A counter the kernel refuses (no PMU, e.g. in a VM, or
+ * perf_event_paranoid too high) or a platform without perf events reads
+ * as unavailable. */
+class CacheCounters {
+public:
+    enum { LLC, L1D, COUNT };
+
+    CacheCounters() {
+#ifdef __linux__
+        fds[LLC] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        fds[L1D] = open(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                        PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+#endif
+    }
+    CacheCounters(const CacheCounters&) = delete;
+    CacheCounters& operator=(const CacheCounters&) = delete;
+    ~CacheCounters() {
+#ifdef __linux__
+        for (int fd : fds) if (fd >= 0) close(fd);
+#endif
+    }
+
+    bool available(int counter) const { return fds[counter] >= 0; }
+
+    void start() {
+#ifdef __linux__
+        for (int fd : fds) {
+            if (fd < 0) continue;
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    /* Add the misses since start() to totals[COUNT] */
+    void stop(uint64_t* totals) {
+#ifdef __linux__
+        for (int c = 0; c < COUNT; c++) {
+            if (fds[c] < 0) continue;
+            ioctl(fds[c], PERF_EVENT_IOC_DISABLE, 0);
+            uint64_t value = 0;
+            if (read(fds[c], &value, sizeof(value)) == sizeof(value)) totals[c] += value;
+        }
+#endif
+    }
+
+private:
+    int fds[COUNT] = {-1, -1};
+
+#ifdef __linux__
+    static int open(uint32_t type, uint64_t config) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+#endif
+};
+
+/* Has access to Maze internals so reconstructPath can be timed on its own
+ * and the player can be put anywhere for checkWeightedCosts() */
+class MazeBench {
+public:
+    static void reconstruct(Maze& maze) {
+        maze.path.clear();
+        maze.reconstructPath(maze.playerScratch, maze.playerPos, maze.targetPos, maze.path);
+    }
+
+    /* Before timing anything: on braided mazes with mud and ice, and with
+     * the player standing on mud, A*, Dijkstra and graph A* must agree on
+     * the cost of the cheapest path between random rooms.  Prints each
+     * disagreement; false if there was one. */
+    static bool checkWeightedCosts() {
+        const SolverType solvers[] = {SOLVER_ASTAR, SOLVER_DIJKSTRA, SOLVER_GRAPH_ASTAR};
+        SolverScratch scratch;
+        std::vector<Vector2i> path;
+        SolveStats stats;
+        int failures = 0;
+        for (uint32_t seed = 1; seed <= 4; seed++) {
+            Maze maze(61, 61, BACKTRACKER, 1, seed, 0.3, 0.3);
+            maze.buildJunctionGraph();
+            Pcg32 rng(seed);
+            std::vector<AgentQuery> queries = randomAgentQueries(maze, 64, rng);
+            for (int y = 1; y < maze.getHeight() - 1; y++) {
+                for (int x = 1; x < maze.getWidth() - 1; x++) {
+                    if (maze.cellType(x, y) != MUD || rng.below(8)) continue;
+                    maze.placePlayer(Vector2i(x, y));
+                    for (const AgentQuery& query : queries) {
+                        uint64_t costs[3];
+                        for (int s = 0; s < 3; s++) {
+                            maze.solve(solvers[s], query.from, query.to, scratch, path, stats);
+                            costs[s] = stats.pathCost;
+                        }
+                        if (costs[0] == costs[1] && costs[1] == costs[2]) continue;
+                        if (failures++ < 8) {
+                            std::printf("cost check: seed %u, player (%d,%d), (%d,%d) to (%d,%d): "
+                                        "astar %llu, dijkstra %llu, graph-astar %llu\n",
+                                        seed, x, y, query.from.x, query.from.y, query.to.x, query.to.y,
+                                        (unsigned long long)costs[0], (unsigned long long)costs[1],
+                                        (unsigned long long)costs[2]);
+                        }
+                    }
+                }
+            }
+        }
+        if (failures) std::printf("cost check: %d disagreements\n", failures);
+        return failures == 0;
+    }
+};
+
+struct BenchOptions {
+    std::vector<int> sizes = {21, 129, 513, 2049, 8193};
+    int seeds = 2;
+    int reps  = 0;
+    GeneratorType generator = BACKTRACKER;
+    double loops   = 0;
+    double terrain = 0;
+    bool render = false;
+};
+
+void parseBenchArgs(int argc, char** argv, BenchOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        if (!std::strcmp(argv[i], "--sizes") && i + 1 < argc) {
+            options.sizes.clear();
+            const char* s = argv[++i];
+            while (*s) {
+                char* end;
+                long size = std::strtol(s, &end, 10);
+                if (end == s) break;
+                options.sizes.push_back(Maze::normalizeSize(size));
+                s = *end == ',' ? end + 1 : end;
+            }
+        } else if (!std::strcmp(argv[i], "--seeds") && i + 1 < argc) {
+            options.seeds = std::max(1, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--reps") && i + 1 < argc) {
+            options.reps = std::max(1, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--algo") && i + 1 < argc) {
+            if (!parseGeneratorName(argv[++i], options.generator)) {
+                std::fprintf(stderr, "Unknown generator: %s\n", argv[i]);
+                exit(1);
+            }
+        } else if (!std::strcmp(argv[i], "--loops") && i + 1 < argc) {
+            options.loops = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--terrain") && i + 1 < argc) {
+            options.terrain = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--render")) {
+            options.render = true;
+        } else {
+            std::fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+            exit(1);
+        }
+    }
+}
+
+/* Roughly constant work per size: many runs on small mazes, a few on huge ones */
+int repetitionsFor(int size, const BenchOptions& options) {
+    if (options.reps) return options.reps;
+    double cells = double(size) * size;
+    return std::max(3, std::min(50, int(4e6 / cells)));
+}
+
+/* Generation and solving over one cell layout, one row per operation */
+template <typename Layout>
+void benchLayout(int size, const BenchOptions& options, CacheCounters& counters) {
+    enum { GENERATE, BFS, ASTAR, OPERATIONS };
+    static const char* names[OPERATIONS] = {"generate", "bfs", "astar"};
+    Sample samples[OPERATIONS];
+    uint64_t misses[OPERATIONS][CacheCounters::COUNT] = {};
+    auto run = [&](int operation, auto&& body) {
+        counters.start();
+        measure(samples[operation], body);
+        counters.stop(misses[operation]);
+    };
+
+    int reps = repetitionsFor(size, options);
+    for (int seed = 1; seed <= options.seeds; seed++) {
+        BasicMaze<Layout> maze(size, size, options.generator, 1, seed);
+        maze.setLoopFraction(options.loops);
+        maze.setTerrainFraction(options.terrain);
+        for (int r = 0; r < reps; r++) {
+            run(GENERATE, [&] { maze.generateMaze(); });
+            maze.reset();
+            maze.setSolver(SOLVER_BFS);
+            run(BFS, [&] { maze.findPath(); });
+            maze.setSolver(SOLVER_ASTAR);
+            run(ASTAR, [&] { maze.findPath(); });
+        }
+    }
+
+    for (int op = 0; op < OPERATIONS; op++) {
+        char counts[CacheCounters::COUNT][24];
+        for (int c = 0; c < CacheCounters::COUNT; c++) {
+            if (counters.available(c)) {
+                std::snprintf(counts[c], sizeof(counts[c]), "%.0f",
+                              double(misses[op][c]) / samples[op].runs);
+            } else {
+                std::snprintf(counts[c], sizeof(counts[c]), "n/a");
+            }
+        }
+        std::printf("%-10s %-10s %12.1f  %14s  %14s\n", Layout::name(), names[op],
+                    percentile(samples[op].micros, 0.5), counts[CacheCounters::LLC],
+                    counts[CacheCounters::L1D]);
+    }
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (std::find_if(argv + 1, argv + argc, [](const char* a) {
+            return !std::strcmp(a, "--render"); }) != argv + argc) {
+        glutInit(&argc, argv);
+    }
+    parseBenchArgs(argc, argv, options);
+
+    MazeRenderer renderer;
+    GpuDistanceField gpuField;
+    if (options.render) {
+        glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB);
+        glutInitWindowSize(1000, 1000);
+        glutCreateWindow("maze_bench");
+        glMatrixMode(GL_MODELVIEW);
+        glLoadIdentity();
+        renderer.setViewport(1000, 1000);
+        if (!gpuField.available()) std::printf("no GPU distance field on this context\n");
+    }
+
+    if (!MazeBench::checkWeightedCosts()) return 1;
+
+    std::printf("generator: %s, loops %.2f, terrain %.2f, %d seed(s) per size\n\n",
+                generatorName(options.generator), options.loops, options.terrain, options.seeds);
+    std::printf("%-14s %6s  %12s  %12s  %10s\n", "operation", "size", "median us",
+                "p99 us", "allocs/op");
+
+    for (int size : options.sizes) {
+        int reps = repetitionsFor(size, options);
+        Sample generate, reconstruct, junctions, fieldCpu, fieldGpu;
+        Sample solve[SOLVER_COUNT];
+        Sample draw[RENDER_MODE_COUNT], redraw[RENDER_MODE_COUNT];
+
+        /* One maze per size, warmed up by a round of every operation first,
+         * so the allocation counts show the steady state: only a new
+         * high-water mark (a longer path, a wider frontier) allocates */
+        Maze maze(size, size, options.generator, 1, 0);
+        maze.setLoopFraction(options.loops);
+        maze.setTerrainFraction(options.terrain);
+        maze.generateNewMaze();
+        for (int s = 0; s < SOLVER_COUNT; s++) {
+            maze.setSolver(SolverType(s));
+            maze.findPath();
+        }
+
+        for (int seed = 1; seed <= options.seeds; seed++) {
+            maze.setSeed(seed);
+            for (int r = 0; r < reps; r++) {
+                measure(generate, [&] { maze.generateMaze(); });
+                maze.reset();
+                measure(junctions, [&] { maze.buildJunctionGraph(); });
+                for (int s = 0; s < SOLVER_COUNT; s++) {
+                    maze.setSolver(SolverType(s));
+                    measure(solve[s], [&] { maze.findPath(); });
+                }
+                maze.setSolver(SOLVER_BFS);
+                maze.findPath();
+                measure(reconstruct, [&] { MazeBench::reconstruct(maze); });
+                measure(fieldCpu, [&] { maze.buildDistanceField(); });
+
+                if (options.render) {
+                    renderer.fitMaze(maze);
+                    for (int mode = 0; mode < RENDER_MODE_COUNT; mode++) {
+                        renderer.setMode(RenderMode(mode));
+                        measure(draw[mode], [&] { renderer.draw(maze); glFinish(); });
+                        /* Step back and forth along the first open direction */
+                        if (!maze.movePlayer(1, 0) && !maze.movePlayer(-1, 0) &&
+                            !maze.movePlayer(0, 1)) maze.movePlayer(0, -1);
+                        measure(redraw[mode], [&] { renderer.draw(maze); glFinish(); });
+                    }
+                    if (gpuField.available()) {
+                        maze.setDistanceFieldBackend(&gpuField);
+                        measure(fieldGpu, [&] { maze.buildDistanceField(); });
+                        maze.setDistanceFieldBackend(nullptr);
+                    }
+                }
+            }
+        }
+
+        report("generate", size, generate);
+        for (int s = 0; s < SOLVER_COUNT; s++) report(solverName(SolverType(s)), size, solve[s]);
+        if (!solve[SOLVER_BFS].micros.empty()) {
+            std::printf("%-14s %6s  %11.2fx vs bfs (%s)\n", "", "",
+                        percentile(solve[SOLVER_BFS].micros, 0.5) /
+                        percentile(solve[SOLVER_BITBOARD].micros, 0.5),
+                        BitboardSolver::simdName());
+        }
+        report("reconstruct", size, reconstruct);
+        report("junctions", size, junctions);
+        report("field/cpu", size, fieldCpu);
+        report("field/gpu", size, fieldGpu);
+        for (int mode = 0; mode < RENDER_MODE_COUNT; mode++) {
+            std::string name = std::string("draw/") + renderModeName(RenderMode(mode));
+            report(name.c_str(), size, draw[mode]);
+            name = std::string("redraw/") + renderModeName(RenderMode(mode));
+            report(name.c_str(), size, redraw[mode]);
+        }
+    }
+
+    /* Cell layouts on the largest maze */
+    if (!options.sizes.empty()) {
+        int size = *std::max_element(options.sizes.begin(), options.sizes.end());
+        CacheCounters counters;
+        std::printf("\ncell layouts at %dx%d\n", size, size);
+        std::printf("%-10s %-10s %12s  %14s  %14s\n", "layout", "operation", "median us",
+                    "llc misses/op", "l1d misses/op");
+        benchLayout<RowMajorLayout>(size, options, counters);
+        benchLayout<TiledLayout<8>>(size, options, counters);
+        benchLayout<MortonLayout>(size, options, counters);
+    }
+
+    /* Thread scaling of tiled generation on the largest maze */
+    if (options.generator == BACKTRACKER && !options.sizes.empty()) {
+        int size = *std::max_element(options.sizes.begin(), options.sizes.end());
+        int reps = repetitionsFor(size, options);
+        std::printf("\nthread scaling at %dx%d (%u hardware threads)\n", size, size,
+                    std::thread::hardware_concurrency());
+        double baseline = 0;
+        for (int threads : {1, 2, 4, 8, 16}) {
+            if (threads > hardwareThreads()) break;  // Maze caps the tiles there
+            Sample tiled;
+            Maze maze(size, size, BACKTRACKER, threads, 1);
+            for (int r = 0; r < reps; r++) measure(tiled, [&] { maze.generateMaze(); });
+            double median = percentile(tiled.micros, 0.5);
+            if (threads == 1) baseline = median;
+            std::string name = "tiled/" + std::to_string(threads);
+            report(name.c_str(), size, tiled);
+            std::printf("%-14s %6s  %11.2fx speed-up\n", "", "", baseline / median);
+        }
+    }
+
+    /* Throughput scaling of concurrent agent queries on one maze */
+    if (!options.sizes.empty()) {
+        int size = *std::min_element(options.sizes.begin(), options.sizes.end());
+        for (int s : options.sizes) {
+            if (s <= 2049) size = std::max(size, s);
+        }
+        int reps = repetitionsFor(size, options);
+        Maze maze(size, size, options.generator, 1, 1);
+        maze.setLoopFraction(options.loops);
+        maze.setTerrainFraction(options.terrain);
+        maze.generateNewMaze();
+        Pcg32 rng(1);
+        size_t count = size_t(std::min(1024.0, std::max(16.0, 1e8 / (double(size) * size))));
+        std::vector<AgentQuery> queries = randomAgentQueries(maze, count, rng);
+        std::vector<AgentResult> results;
+        std::printf("\nagent scaling at %dx%d, %zu bfs queries per batch\n", size, size, count);
+        double baseline = 0;
+        for (int threads : {1, 2, 4, 8, 16}) {
+            Sample batch;
+            AgentSolver agents(threads);
+            agents.solve(maze, SOLVER_BFS, queries, results);  // warm up the scratch buffers
+            for (int r = 0; r < reps; r++) {
+                measure(batch, [&] { agents.solve(maze, SOLVER_BFS, queries, results); });
+            }
+            double median = percentile(batch.micros, 0.5);
+            if (threads == 1) baseline = median;
+            std::string name = "agents/" + std::to_string(threads);
+            report(name.c_str(), size, batch);
+            std::printf("%-14s %6s  %11.2fx speed-up, %.0f queries/s\n", "", "",
+                        baseline / median, count / (median * 1e-6));
+        }
+    }
+
+    /* Maze against the 3D LevelMaze */
+    if (!options.sizes.empty()) {
+        int size = *std::min_element(options.sizes.begin(), options.sizes.end());
+        for (int s : options.sizes) {
+            if (s <= 2049) size = std::max(size, s);
+        }
+        int reps = repetitionsFor(size, options);
+        std::printf("\nlevels at %dx%d, %d seed(s)\n", size, size, options.seeds);
+        Sample generate, bfs, stackedGenerate, stackedBfs;
+        Maze maze(size, size, BACKTRACKER, 1, 0);
+        LevelMaze stacked(Vector3i(size, size, 9), 0);
+        LevelScratch stackedScratch;
+        std::vector<Vector3i> stackedPath;
+        SolveStats stats;
+        stacked.solve(stacked.getStart(), stacked.getTarget(), stackedScratch, stackedPath, stats);
+        for (int seed = 1; seed <= options.seeds; seed++) {
+            maze.setSeed(seed);
+            stacked.setSeed(seed);
+            for (int r = 0; r < reps; r++) {
+                /* LevelMaze clears the visited flags itself, Maze in reset() */
+                measure(generate, [&] { maze.generateMaze(); maze.reset(); });
+                measure(bfs, [&] { maze.findPath(); });
+                measure(stackedGenerate, [&] { stacked.generate(); });
+                measure(stackedBfs, [&] {
+                    stacked.solve(stacked.getStart(), stacked.getTarget(), stackedScratch, stackedPath, stats);
+                });
+            }
+        }
+        report("maze+reset", size, generate);
+        report("maze/bfs", size, bfs);
+        report("levels/gen", size, stackedGenerate);
+        report("levels/bfs", size, stackedBfs);
+        std::printf("%-14s %6s  %12.1f  Mcells/s generated on 4 levels, %.1f on one\n", "", "",
+                    stacked.cellCount() / percentile(stackedGenerate.micros, 0.5),
+                    double(size) * size / percentile(generate.micros, 0.5));
+    }
+    return 0;
+}
@@ -0,0 +1,2270 @@
+/*
+ * Maze generation and solving, independent of any window system.
+ *
+ * Maze keeps the grid as one byte per cell and offers several generators
+ * (back-tracking, optionally tiled across threads, and row-streaming
+ * binary tree / sidewinder / Eller) and solvers (BFS, bidirectional BFS,
+ * A*, Dijkstra, a precomputed distance field and a bit-parallel BFS).
+ * Mazes can optionally be braided (dead ends opened into loops) and
+ * scattered with mud and ice, which only A* and Dijkstra weigh.
+ */
+
+#ifndef MAZE_CORE_H
+#define MAZE_CORE_H
+
+#include <vector>
+#include <algorithm>
+#include <ctime>
+#include <chrono>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <type_traits>
+
+#include "maze_layout.h"
+#include "maze_stats.h"
+
+const int DEFAULT_MAZE_WIDTH  = 21;
+const int DEFAULT_MAZE_HEIGHT = 21;
+
+enum CellType : uint8_t {
+    WALL,
+    PATH,
+    PLAYER,
+    TARGET,
+    MUD,    // open, but slow to cross
+    ICE,    // open and fast to cross
+    STAIRS_UP,   // one level of a multi-level maze (maze_levels.h): the
+    STAIRS_DOWN, // room has a stairwell to the level above, below
+    STAIRS       // or both
+};
+
+/* Cost of entering a cell for the weighted solvers (A* and Dijkstra);
+ * the BFS-based solvers count every step as one */
+const uint32_t MAX_STEP_COST = 5;
+inline uint32_t stepCost(CellType type) {
+    switch (type) {
+        case MUD: return MAX_STEP_COST;
+        case ICE: return 1;
+        default:  return 2;
+    }
+}
+
+/* Each cell is a single byte: the low bits hold the CellType and the
+ * top bit the visited flag used while carving, so the whole maze is one
+ * contiguous buffer.  Solvers keep their marks in a SolverScratch. */
+const uint8_t CELL_TYPE_MASK = 0x0f;
+const uint8_t CELL_VISITED   = 0x80;
+
+const uint32_t UNREACHABLE = UINT32_MAX; // distance of walls and cut-off cells
+
+struct Vector2i {
+    int x, y;
+    constexpr Vector2i(int x = 0, int y = 0) : x(x), y(y) {}
+    bool operator==(const Vector2i& other) const {
+        return x == other.x && y == other.y;
+    }
+};
+
+/* Unit steps east, west, south, north.  A direction is an index into this
+ * table, which is also what the solvers' 2-bit parent directions store. */
+constexpr Vector2i DIRECTIONS[4] = {Vector2i(1, 0), Vector2i(-1, 0), Vector2i(0, 1), Vector2i(0, -1)};
+
+/* FIFO queue over a power-of-two ring buffer.  Storage only ever grows, so
+ * a queue that is cleared and reused stops allocating once warmed up. */
+template <typename T>
+class RingQueue {
+public:
+    bool   empty() const { return head == tail; }
+    size_t size()  const { return tail - head; }
+    void   clear() { head = tail = peakSize = 0; }
+    /* Largest size since the last clear() */
+    size_t peak()  const { return peakSize; }
+
+    const T& front() const { return buffer[head & mask]; }
+    void pop() { head++; }
+
+    void push(const T& value) {
+        if (size() == buffer.size()) grow();
+        buffer[tail++ & mask] = value;
+        if (size() > peakSize) peakSize = size();
+    }
+
+private:
+    std::vector<T> buffer;
+    size_t mask = 0;
+    size_t head = 0;
+    size_t tail = 0;
+    size_t peakSize = 0;
+
+    void grow() {
+        size_t capacity = buffer.empty() ? 64 : buffer.size() * 2;
+        std::vector<T> larger(capacity);
+        for (size_t i = 0; i < size(); i++) larger[i] = buffer[(head + i) & mask];
+        tail = size();
+        head = 0;
+        buffer.swap(larger);
+        mask = capacity - 1;
+    }
+};
+
+/* Monotone priority queue for small integer keys (Dial's algorithm): a
+ * ring of buckets, one per key.  Every key pushed must lie in [k, k + span)
+ * where k is the smallest key still queued, which holds for Dijkstra and
+ * for A* with a consistent heuristic when steps cost less than span / 2.
+ * Push and pop are O(1); buckets keep their storage between searches. */
+template <typename T>
+class BucketQueue {
+public:
+    /* Empty the queue and size the ring for keys spread over `span` */
+    void reset(uint32_t span) {
+        size_t size = 1;
+        while (size < span) size *= 2;
+        if (buckets.size() != size) buckets.resize(size);
+        for (auto& bucket : buckets) bucket.clear();
+        mask    = size - 1;
+        count   = 0;
+        peakCount = 0;
+        current = UINT32_MAX;
+    }
+
+    bool empty() const { return count == 0; }
+    /* Most entries queued at once since the last reset() */
+    size_t peak() const { return peakCount; }
+
+    void push(uint32_t key, const T& value) {
+        if (key < current) current = key;
+        buckets[key & mask].push_back(value);
+        if (++count > peakCount) peakCount = count;
+    }
+
+    /* Remove an entry with the smallest key, the last pushed among equals */
+    T pop(uint32_t& key) {
+        while (buckets[current & mask].empty()) current++;
+        std::vector<T>& bucket = buckets[current & mask];
+        T value = bucket.back();
+        bucket.pop_back();
+        count--;
+        key = current;
+        return value;
+    }
+
+private:
+    std::vector<std::vector<T>> buckets;
+    size_t   mask    = 0;
+    size_t   count   = 0;
+    size_t   peakCount = 0;
+    uint32_t current = UINT32_MAX; // no queued key is smaller
+};
+
+/* PCG32 (XSH-RR output, 64-bit state).  Unlike std::mt19937 combined with
+ * std::uniform_int_distribution and std::shuffle, every step is specified
+ * here, so a seed produces the same maze with libstdc++, libc++ and MSVC;
+ * it is also cheaper per draw. */
+class Pcg32 {
+public:
+    using result_type = uint32_t;
+
+    explicit Pcg32(uint64_t seed = 0, uint64_t stream = 0) { this->seed(seed, stream); }
+
+    void seed(uint64_t value, uint64_t stream = 0) {
+        state = 0;
+        increment = (stream << 1) | 1;
+        (*this)();
+        state += value;
+        (*this)();
+    }
+
+    uint32_t operator()() {
+        uint64_t old = state;
+        state = old * 6364136223846793005ULL + increment;
+        uint32_t shifted = static_cast<uint32_t>(((old >> 18) ^ old) >> 27);
+        uint32_t rotation = static_cast<uint32_t>(old >> 59);
+        return (shifted >> rotation) | (shifted << ((32 - rotation) & 31));
+    }
+
+    /* Uniform value in [0, bound), bound > 0: Lemire's multiply-shift with
+     * rejection of the few biased products */
+    uint32_t below(uint32_t bound) {
+        uint64_t product = static_cast<uint64_t>((*this)()) * bound;
+        uint32_t low = static_cast<uint32_t>(product);
+        if (low < bound) {
+            uint32_t threshold = (0u - bound) % bound;
+            while (low < threshold) {
+                product = static_cast<uint64_t>((*this)()) * bound;
+                low = static_cast<uint32_t>(product);
+            }
+        }
+        return static_cast<uint32_t>(product >> 32);
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT32_MAX; }
+
+    /* The full generator position, e.g. for a maze file to continue from */
+    uint64_t getState() const { return state; }
+    uint64_t getIncrement() const { return increment; }
+    void restore(uint64_t savedState, uint64_t savedIncrement) {
+        state = savedState;
+        increment = savedIncrement | 1;
+    }
+
+private:
+    uint64_t state = 0;
+    uint64_t increment = 1;
+};
+
+/* Fisher-Yates with Pcg32::below, in place of the unspecified std::shuffle */
+template <typename T>
+void shuffleWith(std::vector<T>& values, Pcg32& rng) {
+    for (size_t i = values.size(); i > 1; i--) {
+        std::swap(values[i - 1], values[rng.below(static_cast<uint32_t>(i))]);
+    }
+}
+
+/* Threads the machine runs at once, at least 1 */
+inline int hardwareThreads() {
+    return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+/* A fixed set of worker threads running parallel loops.  run(count, task)
+ * calls task(i, worker) for every i in [0, count), handing out one index
+ * at a time, and returns once all calls are done.  `worker` is the index
+ * of the calling thread in [0, size()), for per-thread state.  The task
+ * is called through a plain function pointer, so a batch never allocates. */
+class ThreadPool {
+public:
+    explicit ThreadPool(int threads) {
+        for (int t = 0; t < std::max(1, threads); t++) {
+            workers.emplace_back([this, t]() { work(t); });
+        }
+    }
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    int size() const { return static_cast<int>(workers.size()); }
+
+    template <typename Task>
+    void run(size_t count, Task&& task) {
+        using Callable = typename std::remove_reference<Task>::type;
+        std::unique_lock<std::mutex> lock(mutex);
+        job = const_cast<void*>(static_cast<const void*>(&task));
+        invoke = [](void* callable, size_t i, int worker) {
+            (*static_cast<Callable*>(callable))(i, worker);
+        };
+        jobSize = count;
+        next = 0;
+        busy = workers.size();
+        batch++;
+        wake.notify_all();
+        done.wait(lock, [this]() { return busy == 0; });
+        job = nullptr;
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    void* job = nullptr;
+    void (*invoke)(void*, size_t, int) = nullptr;
+    size_t jobSize = 0;
+    std::atomic<size_t> next{0};
+    size_t   busy  = 0;     // workers still on the current batch
+    uint64_t batch = 0;     // bumped for every run()
+    bool stopping = false;
+
+    void work(int worker) {
+        uint64_t seen = 0;
+        for (;;) {
+            void* task;
+            void (*call)(void*, size_t, int);
+            size_t count;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&]() { return stopping || batch != seen; });
+                if (stopping) return;
+                seen  = batch;
+                task  = job;
+                call  = invoke;
+                count = jobSize;
+            }
+            for (size_t i = next++; i < count; i = next++) call(task, i, worker);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--busy == 0) done.notify_one();
+        }
+    }
+};
+
+/* The workers of tiled generation, shared by every maze and started on
+ * first use.  run() takes one batch at a time, so a maze holds
+ * generationPoolMutex() around it. */
+inline ThreadPool& generationPool() {
+    static ThreadPool pool(hardwareThreads());
+    return pool;
+}
+inline std::mutex& generationPoolMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+enum GeneratorType {
+    BACKTRACKER,
+    BINARY_TREE,
+    SIDEWINDER,
+    ELLER,
+    GENERATOR_COUNT
+};
+
+inline const char* generatorName(GeneratorType type) {
+    switch (type) {
+        case BACKTRACKER: return "backtracker";
+        case BINARY_TREE: return "binary-tree";
+        case SIDEWINDER:  return "sidewinder";
+        case ELLER:       return "eller";
+        default:          return "unknown";
+    }
+}
+
+inline bool parseGeneratorName(const char* name, GeneratorType& type) {
+    for (int i = 0; i < GENERATOR_COUNT; i++) {
+        if (!std::strcmp(name, generatorName(GeneratorType(i)))) {
+            type = GeneratorType(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+enum SolverType {
+    SOLVER_BFS,
+    SOLVER_BIDIRECTIONAL,
+    SOLVER_ASTAR,
+    SOLVER_DISTANCE_FIELD,
+    SOLVER_BITBOARD,
+    SOLVER_DIJKSTRA,
+    SOLVER_GRAPH,        // fewest steps over the junction graph
+    SOLVER_GRAPH_ASTAR,  // lowest terrain cost over the junction graph
+    SOLVER_COUNT
+};
+
+inline const char* solverName(SolverType type) {
+    switch (type) {
+        case SOLVER_BFS:           return "bfs";
+        case SOLVER_BIDIRECTIONAL: return "bidirectional";
+        case SOLVER_ASTAR:         return "astar";
+        case SOLVER_DISTANCE_FIELD: return "field";
+        case SOLVER_BITBOARD:      return "bitboard";
+        case SOLVER_DIJKSTRA:      return "dijkstra";
+        case SOLVER_GRAPH:         return "graph";
+        case SOLVER_GRAPH_ASTAR:   return "graph-astar";
+        default:                   return "unknown";
+    }
+}
+
+inline bool parseSolverName(const char* name, SolverType& type) {
+    for (int i = 0; i < SOLVER_COUNT; i++) {
+        if (!std::strcmp(name, solverName(SolverType(i)))) {
+            type = SolverType(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Counters for the most recent solve */
+struct SolveStats {
+    SolverType solver = SOLVER_BFS;
+    size_t cellsExpanded = 0;
+    double microseconds  = 0.0;
+    uint64_t pathCost    = 0;   // sum of stepCost() of the terrain along the path found
+    size_t   queuePeak   = 0;   // largest frontier (queue entries or cells)
+};
+
+/*
+ * Bit-parallel BFS over 8x8 tiles: every cell is one bit of a 64-bit word
+ * (bit = 8 * row + column inside the tile) in three planes, open, visited
+ * and frontier.  A whole tile's frontier grows by one step with a handful
+ * of shifts and ANDs, and only tiles that hold frontier bits are touched.
+ * The BFS layer of each visited cell is kept modulo 3 in two more planes;
+ * neighbouring cells differ by at most one layer, so that is enough to
+ * walk back from the target.  Packing the cell bytes into the open plane
+ * uses AVX2, SSE2 or NEON when the compiler targets them.
+ */
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define MAZE_BITBOARD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MAZE_BITBOARD_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define MAZE_BITBOARD_NEON
+#endif
+
+inline int popcount64(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(v);
+#else
+    v = v - ((v >> 1) & 0x5555555555555555ULL);
+    v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+    v = (v + (v >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return static_cast<int>((v * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+class BitboardSolver {
+public:
+    /* Instruction set used to pack the open plane */
+    static const char* simdName() {
+#if defined(MAZE_BITBOARD_AVX2)
+        return "avx2";
+#elif defined(MAZE_BITBOARD_SSE2)
+        return "sse2";
+#elif defined(MAZE_BITBOARD_NEON)
+        return "neon";
+#else
+        return "scalar";
+#endif
+    }
+
+    /* Pack a row-major width x height grid of cell bytes into the open plane */
+    void load(const uint8_t* cells, int width, int height) {
+        resize(width, height);
+        for (int y = 0; y < height; y++) loadRow(cells + size_t(y) * width, y);
+    }
+
+    /* Size the planes for a width x height grid with every cell closed;
+     * loadRow() then fills in the rows */
+    void resize(int width, int height) {
+        this->width  = width;
+        this->height = height;
+        tilesX = (width + 7) / 8;
+        tilesY = (height + 7) / 8;
+        size_t tileCount = size_t(tilesX) * tilesY;
+        open.assign(tileCount, 0);
+        visited.assign(tileCount, 0);
+        frontier.assign(tileCount, 0);
+        next.assign(tileCount, 0);
+        layerLow.assign(tileCount, 0);
+        layerHigh.assign(tileCount, 0);
+    }
+
+    /* Pack cell row y (width bytes) */
+    void loadRow(const uint8_t* row, int y) {
+        uint64_t* tiles = &open[size_t(y >> 3) * tilesX];
+        int shift = (y & 7) * 8;
+        int x = 0;
+#if defined(MAZE_BITBOARD_AVX2)
+        const __m256i typeMask = _mm256_set1_epi8(CELL_TYPE_MASK);
+        for (; x + 32 <= width; x += 32) {
+            __m256i bytes = _mm256_and_si256(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + x)), typeMask);
+            uint32_t bits = ~static_cast<uint32_t>(_mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(bytes, _mm256_setzero_si256())));
+            for (int k = 0; k < 4; k++) tiles[(x >> 3) + k] |= uint64_t((bits >> (8 * k)) & 0xff) << shift;
+        }
+#elif defined(MAZE_BITBOARD_SSE2)
+        const __m128i typeMask = _mm_set1_epi8(CELL_TYPE_MASK);
+        for (; x + 16 <= width; x += 16) {
+            __m128i bytes = _mm_and_si128(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x)), typeMask);
+            uint32_t bits = ~static_cast<uint32_t>(_mm_movemask_epi8(
+                _mm_cmpeq_epi8(bytes, _mm_setzero_si128())));
+            tiles[x >> 3]       |= uint64_t(bits & 0xff) << shift;
+            tiles[(x >> 3) + 1] |= uint64_t((bits >> 8) & 0xff) << shift;
+        }
+#elif defined(MAZE_BITBOARD_NEON)
+        const uint8x8_t typeMask = vdup_n_u8(CELL_TYPE_MASK);
+        const uint8x8_t weights  = {1, 2, 4, 8, 16, 32, 64, 128};
+        for (; x + 8 <= width; x += 8) {
+            uint8x8_t isOpen = vtst_u8(vld1_u8(row + x), typeMask);
+            tiles[x >> 3] |= uint64_t(vaddv_u8(vand_u8(isOpen, weights))) << shift;
+        }
+#endif
+        for (; x < width; x++) {
+            if (row[x] & CELL_TYPE_MASK) tiles[x >> 3] |= uint64_t(1) << (shift + (x & 7));
+        }
+    }
+
+    /* Shortest path between two open cells of the loaded grid, stored like
+     * Maze's path (target first, without `from`); false if none exists */
+    bool solve(Vector2i from, Vector2i to) {
+        std::fill(visited.begin(), visited.end(), 0);
+        std::fill(layerLow.begin(), layerLow.end(), 0);
+        std::fill(layerHigh.begin(), layerHigh.end(), 0);
+        path.clear();
+        expanded = 0;
+        frontierPeak = 1;
+        size_t layerCells = 0;
+
+        size_t targetTile = tileOf(to);
+        uint64_t targetBit = bitOf(to);
+        active.clear();
+        active.push_back(static_cast<uint32_t>(tileOf(from)));
+        frontier[active[0]] = visited[active[0]] = bitOf(from);
+
+        uint32_t layer = 0;
+        while (!active.empty() && !(visited[targetTile] & targetBit)) {
+            layer++;
+            for (uint32_t t : active) expand(t);
+            for (uint32_t t : active) frontier[t] = 0;
+
+            /* Commit the new layer */
+            uint64_t low  = (layer % 3) & 1 ? ~uint64_t(0) : 0;
+            uint64_t high = (layer % 3) & 2 ? ~uint64_t(0) : 0;
+            for (uint32_t t : nextActive) {
+                uint64_t bits = next[t];
+                next[t] = 0;
+                frontier[t] = bits;
+                visited[t] |= bits;
+                layerLow[t]  |= bits & low;
+                layerHigh[t] |= bits & high;
+                layerCells += popcount64(bits);
+            }
+            expanded += layerCells;
+            frontierPeak = std::max(frontierPeak, layerCells);
+            layerCells = 0;
+            active.swap(nextActive);
+            nextActive.clear();
+        }
+        for (uint32_t t : active) frontier[t] = 0;
+        if (!(visited[targetTile] & targetBit)) return false;
+
+        /* Walk back through neighbours one layer (mod 3) closer */
+        static const int stepX[4] = {1, -1, 0, 0}, stepY[4] = {0, 0, 1, -1};
+        Vector2i current = to;
+        for (uint32_t d = layer; d > 0; d--) {
+            path.push_back(current);
+            uint32_t wanted = (d - 1) % 3;
+            for (int k = 0; k < 4; k++) {
+                Vector2i n(current.x + stepX[k], current.y + stepY[k]);
+                if (n.x < 0 || n.y < 0 || n.x >= width || n.y >= height) continue;
+                size_t t = tileOf(n);
+                uint64_t bit = bitOf(n);
+                if (!(visited[t] & bit)) continue;
+                uint32_t code = ((layerLow[t] & bit) ? 1 : 0) | ((layerHigh[t] & bit) ? 2 : 0);
+                if (code == wanted) {
+                    current = n;
+                    break;
+                }
+            }
+        }
+        return true;
+    }
+
+    const std::vector<Vector2i>& getPath() const { return path; }
+    size_t cellsExpanded() const { return expanded; }
+    /* Most cells in one BFS layer of the last solve */
+    size_t largestFrontier() const { return frontierPeak; }
+
+private:
+    static const uint64_t COLUMN_0 = 0x0101010101010101ULL;
+    static const uint64_t COLUMN_7 = 0x8080808080808080ULL;
+
+    int width = 0, height = 0, tilesX = 0, tilesY = 0;
+    std::vector<uint64_t> open, visited, frontier, next, layerLow, layerHigh;
+    std::vector<uint32_t> active, nextActive;  // tiles with frontier bits
+    std::vector<Vector2i> path;
+    size_t expanded = 0;
+    size_t frontierPeak = 0;
+
+    size_t tileOf(Vector2i p) const { return size_t(p.y >> 3) * tilesX + (p.x >> 3); }
+    static uint64_t bitOf(Vector2i p) { return uint64_t(1) << (((p.y & 7) << 3) | (p.x & 7)); }
+
+    void offer(size_t t, uint64_t bits) {
+        bits &= open[t] & ~visited[t];
+        if (!bits) return;
+        if (!next[t]) nextActive.push_back(static_cast<uint32_t>(t));
+        next[t] |= bits;
+    }
+
+    /* One BFS step for the frontier of tile t: spread inside the tile,
+     * then carry edge bits into the four neighbouring tiles */
+    void expand(uint32_t t) {
+        uint64_t f = frontier[t];
+        offer(t, ((f << 1) & ~COLUMN_0) | ((f >> 1) & ~COLUMN_7) | (f << 8) | (f >> 8));
+        int tx = int(t % tilesX), ty = int(t / tilesX);
+        if (tx + 1 < tilesX && (f & COLUMN_7)) offer(t + 1, (f & COLUMN_7) >> 7);
+        if (tx > 0          && (f & COLUMN_0)) offer(t - 1, (f & COLUMN_0) << 7);
+        if (ty + 1 < tilesY && (f >> 56))      offer(t + tilesX, f >> 56);
+        if (ty > 0          && (f & 0xff))     offer(t - tilesX, f << 56);
+    }
+};
+
+/* Open list entry of the weighted solvers */
+struct CostEntry {
+    uint32_t g;
+    Vector2i pos;
+};
+
+const uint8_t SCRATCH_REACHED      = 1;
+const uint8_t SCRATCH_REACHED_BACK = 2; // reached from the target (bidirectional BFS)
+
+/*
+ * A maze reduced to its nodes, the open cells without exactly two open
+ * neighbours (junctions and dead ends), and the corridors between them.
+ * Each corridor is stored once per direction as an edge with its length
+ * in steps, its terrain cost and the direction it leaves its node in; the
+ * corridor cells stay in the grid and are only walked to write out a path.
+ * A back-tracked maze has about one node per five rooms.
+ */
+struct JunctionGraph {
+    static const uint32_t NONE = UINT32_MAX;
+
+    struct Node {
+        size_t   cell; // layout index
+        Vector2i pos;
+    };
+    struct Edge {
+        uint32_t to;
+        uint32_t length; // steps to `to`
+        uint32_t cost;   // stepCost() of the cells entered, `to` included
+        uint8_t  dir;    // DIRECTIONS index of the first step
+    };
+
+    std::vector<Node>     nodes;     // row by row, ascending x in each row
+    std::vector<uint32_t> rowStart;  // first node of each grid row, plus the node count
+    std::vector<uint32_t> firstEdge; // edges of node n: [firstEdge[n], firstEdge[n + 1]), by direction
+    std::vector<Edge>     edges;
+
+    uint32_t nodeCount() const { return static_cast<uint32_t>(nodes.size()); }
+
+    /* Node at `pos`, or NONE for a corridor cell or wall */
+    uint32_t nodeAt(Vector2i pos) const {
+        auto first = nodes.begin() + rowStart[pos.y], last = nodes.begin() + rowStart[pos.y + 1];
+        auto it = std::lower_bound(first, last, pos.x,
+                                   [](const Node& node, int x) { return node.pos.x < x; });
+        return it != last && it->pos.x == pos.x ? static_cast<uint32_t>(it - nodes.begin()) : NONE;
+    }
+
+    size_t memoryBytes() const {
+        return nodes.capacity() * sizeof(Node) + (rowStart.capacity() + firstEdge.capacity()) *
+               sizeof(uint32_t) + edges.capacity() * sizeof(Edge);
+    }
+};
+
+/* Open-list entry and path piece of the junction graph search */
+struct GraphEntry {
+    uint32_t key, g, node;
+    bool operator>(const GraphEntry& other) const { return key > other.key; }
+};
+struct GraphSegment {
+    Vector2i start, end; // walk the corridor from start (excluded) to end
+    int dir;
+};
+
+/* Working memory of one path search, so that solving never writes to the
+ * maze.  Buffers only grow; a scratch reused on mazes of one size stops
+ * allocating.  Give each thread its own. */
+struct SolverScratch {
+    std::vector<uint8_t>   marks;      // SCRATCH_REACHED* per cell
+    std::vector<uint8_t>   parentDirs; // arrival directions, 2 bits per cell
+    RingQueue<Vector2i>    queue;
+    RingQueue<Vector2i>    queueBack;  // frontier grown from the target
+    BucketQueue<CostEntry> openBuckets;
+    std::vector<uint32_t>  gScore;     // valid only where marks is set
+    BitboardSolver         bitboard;
+    uint64_t               bitboardVersion = 0; // maze version packed into bitboard
+    std::vector<uint8_t>   row;        // one grid row gathered from a non-row-major layout
+    std::vector<uint32_t>  nodeG;      // junction graph search: best cost per node
+    std::vector<uint32_t>  nodeParent;
+    std::vector<uint8_t>   nodeDir;    // direction the corridor into each node leaves its parent
+    std::vector<GraphEntry> graphHeap;
+    std::vector<GraphSegment> segments; // corridors of the path found, goal first
+
+    /* Clear the marks and queues for a search over `cellCount` cells */
+    void prepare(size_t cellCount) {
+        marks.assign(cellCount, 0);
+        parentDirs.resize((cellCount + 3) / 4);
+        queue.clear();
+        queueBack.clear();
+    }
+};
+
+/*
+ * Streaming generators that produce the maze one grid row at a time while
+ * only keeping the state of the current row.  A tall maze can therefore be
+ * written straight to disk or uploaded to the GPU without ever holding the
+ * full grid.  Cells sit at odd coordinates; carveRow() opens passages east
+ * inside the cell row and south into the wall row below it.
+ */
+class RowGenerator {
+public:
+    RowGenerator(int width, int height, Pcg32& rng)
+        : width(width), height(height), columns(width / 2), rows(height / 2),
+          rng(&rng), cellRow(width), southRow(width) {}
+    virtual ~RowGenerator() {}
+
+    /* Start another maze of the same size from the first row, drawing from
+     * `random`; the row buffers are reused, so this does not allocate */
+    void restart(Pcg32& random) {
+        rng = &random;
+        emitted = 0;
+        restartRows();
+    }
+
+    int getWidth()  const { return width; }
+    int getHeight() const { return height; }
+
+    /* Fill out[0 .. width) with the next grid row; false once all rows are done */
+    bool nextRow(uint8_t* out) {
+        if (emitted >= height) return false;
+
+        if (emitted == 0 || emitted == height - 1) {
+            std::fill(out, out + width, static_cast<uint8_t>(WALL));
+        } else if (emitted % 2 == 1) {
+            int row = emitted / 2;
+            std::fill(cellRow.begin(), cellRow.end(), static_cast<uint8_t>(WALL));
+            std::fill(southRow.begin(), southRow.end(), static_cast<uint8_t>(WALL));
+            for (int x = 1; x < width - 1; x += 2) cellRow[x] = PATH;
+            carveRow(row, row == rows - 1);
+            std::copy(cellRow.begin(), cellRow.end(), out);
+        } else {
+            std::copy(southRow.begin(), southRow.end(), out);
+        }
+        emitted++;
+        return true;
+    }
+
+protected:
+    int width, height;
+    int columns, rows; // cell (not grid) dimensions
+    Pcg32* rng;
+
+    void carveEast(int column)  { cellRow[2 * column + 2] = PATH; }
+    void carveSouth(int column) { southRow[2 * column + 1] = PATH; }
+    bool coinFlip() { return (*rng)() & 1; }
+    int  randomBelow(int n) { return static_cast<int>(rng->below(n)); }
+
+    virtual void carveRow(int row, bool lastRow) = 0;
+    /* Forget the state carried between rows */
+    virtual void restartRows() {}
+
+private:
+    std::vector<uint8_t> cellRow;
+    std::vector<uint8_t> southRow;
+    int emitted = 0;
+};
+
+/* Every cell opens either east or south; the last row and column form corridors */
+class BinaryTreeGenerator : public RowGenerator {
+public:
+    using RowGenerator::RowGenerator;
+
+protected:
+    void carveRow(int /*row*/, bool lastRow) override {
+        for (int c = 0; c < columns; c++) {
+            bool canEast = c < columns - 1;
+            if (canEast && (lastRow || coinFlip())) carveEast(c);
+            else if (!lastRow) carveSouth(c);
+        }
+    }
+};
+
+/* Runs of east passages, each closed by one south passage from a random
+ * cell of the run; the bottom row is a single corridor */
+class SidewinderGenerator : public RowGenerator {
+public:
+    using RowGenerator::RowGenerator;
+
+protected:
+    void carveRow(int /*row*/, bool lastRow) override {
+        int runStart = 0;
+        for (int c = 0; c < columns; c++) {
+            bool closeRun = c == columns - 1 || (!lastRow && coinFlip());
+            if (!closeRun) {
+                carveEast(c);
+            } else if (!lastRow) {
+                carveSouth(runStart + randomBelow(c - runStart + 1));
+                runStart = c + 1;
+            }
+        }
+    }
+};
+
+/* Eller's algorithm: cells of the row carry set labels, neighbouring sets
+ * are merged at random, and every set continues south at least once.  Set
+ * labels are tracked with a union-find over at most 2 * columns ids. */
+class EllerGenerator : public RowGenerator {
+public:
+    EllerGenerator(int width, int height, Pcg32& rng)
+        : RowGenerator(width, height, rng),
+          sets(columns), parent(2 * columns), relabel(2 * columns, -1),
+          setSize(2 * columns), chosen(2 * columns), hasSouth(2 * columns),
+          south(columns, false) {
+        for (int c = 0; c < columns; c++) sets[c] = c;
+    }
+
+protected:
+    void restartRows() override {
+        for (int c = 0; c < columns; c++) sets[c] = c;
+        std::fill(south.begin(), south.end(), false);
+    }
+
+    void carveRow(int row, bool lastRow) override {
+        if (row > 0) startRow();
+        for (int id = 0; id < 2 * columns; id++) parent[id] = id;
+
+        for (int c = 0; c + 1 < columns; c++) {
+            int a = find(sets[c]);
+            int b = find(sets[c + 1]);
+            if (a != b && (lastRow || coinFlip())) {
+                parent[b] = a;
+                carveEast(c);
+            }
+        }
+        if (lastRow) return;
+
+        /* Pick one random member per set via reservoir sampling so every set
+         * is guaranteed a passage south */
+        for (int c = 0; c < columns; c++) {
+            int root = find(sets[c]);
+            sets[c] = root;
+            setSize[root] = 0;
+            hasSouth[root] = false;
+        }
+        for (int c = 0; c < columns; c++) {
+            int root = sets[c];
+            if (randomBelow(++setSize[root]) == 0) chosen[root] = c;
+            south[c] = coinFlip();
+            if (south[c]) hasSouth[root] = true;
+        }
+        for (int c = 0; c < columns; c++) {
+            int root = sets[c];
+            if (!hasSouth[root]) south[chosen[root]] = true;
+            if (south[c]) carveSouth(c);
+        }
+    }
+
+private:
+    std::vector<int>  sets;     // set label of each cell in the current row
+    std::vector<int>  parent;   // union-find over labels
+    std::vector<int>  relabel;  // old label -> compacted label
+    std::vector<int>  setSize;
+    std::vector<int>  chosen;
+    std::vector<bool> hasSouth;
+    std::vector<bool> south;    // whether each cell opened south last row
+
+    int find(int id) {
+        while (parent[id] != id) {
+            parent[id] = parent[parent[id]];
+            id = parent[id];
+        }
+        return id;
+    }
+
+    /* Cells that were reached from above keep their set, the rest get fresh
+     * labels; labels are compacted into [0, columns) */
+    void startRow() {
+        int next = 0;
+        for (int c = 0; c < columns; c++) {
+            if (south[c]) {
+                int& label = relabel[sets[c]];
+                if (label < 0) label = next++;
+                sets[c] = label;
+            } else {
+                sets[c] = -1;
+            }
+        }
+        std::fill(relabel.begin(), relabel.end(), -1);
+        for (int c = 0; c < columns; c++) {
+            if (sets[c] < 0) sets[c] = next++;
+        }
+    }
+};
+
+inline std::unique_ptr<RowGenerator> makeRowGenerator(GeneratorType type, int width,
+                                                      int height, Pcg32& rng) {
+    switch (type) {
+        case BINARY_TREE: return std::unique_ptr<RowGenerator>(new BinaryTreeGenerator(width, height, rng));
+        case SIDEWINDER:  return std::unique_ptr<RowGenerator>(new SidewinderGenerator(width, height, rng));
+        case ELLER:       return std::unique_ptr<RowGenerator>(new EllerGenerator(width, height, rng));
+        default:          return nullptr;
+    }
+}
+
+/* Everything that decides which maze Maze::generateMaze() produces next:
+ * size, generator settings, display options and the RNG state */
+struct MazeRecipe {
+    int width, height;
+    GeneratorType generator;
+    int threads;
+    double loopFraction, terrainFraction;
+    bool fieldEnabled, graphEnabled, showHeatMap;
+    SolverType solver;
+    Pcg32 rng;
+    uint32_t seed, generated;
+};
+
+/* Somewhere other than the CPU BFS to compute the distance field, e.g.
+ * the GPU (maze_gpu.h).  Maze::buildDistanceField() falls back to its own
+ * BFS whenever build() returns false. */
+class DistanceFieldBackend {
+public:
+    virtual ~DistanceFieldBackend() {}
+
+    /* Fill distances[y * width + x] with the steps from `target` to each
+     * cell of the row-major grid of cell bytes, UNREACHABLE for walls and
+     * cells cut off from it */
+    virtual bool build(int width, int height, const uint8_t* cells, Vector2i target,
+                       uint32_t* distances) = 0;
+};
+
+/* Where a progressive generation stands */
+enum GenerationPhase {
+    GEN_IDLE,
+    GEN_CARVE,    // back-tracking
+    GEN_TILED,    // parallel back-tracking, done in one slice
+    GEN_ROWS,     // RowGenerator rows
+    GEN_BRAID,
+    GEN_TERRAIN
+};
+
+/* The maze grid, its player and its solvers.  Cells are stored in the
+ * order given by Layout (see maze_layout.h); Maze is the instantiation
+ * picked at build time, used by the app, the renderer and the other
+ * headers. */
+template <typename Layout>
+class BasicMaze {
+public:
+    /* Width and height are rounded up to odd values (minimum 5) so that the
+     * maze always has a solid outer wall ring.  The braiding and terrain
+     * fractions already apply to this first maze. */
+    BasicMaze(int w = DEFAULT_MAZE_WIDTH, int h = DEFAULT_MAZE_HEIGHT,
+         GeneratorType generator = BACKTRACKER, int threads = 1,
+         uint32_t seed = static_cast<uint32_t>(std::time(nullptr)),
+         double loopFraction = 0, double terrainFraction = 0)
+        : width(normalizeSize(w)), height(normalizeSize(h)), generator(generator),
+          threads(clampThreads(threads)) {
+        setLoopFraction(loopFraction);
+        setTerrainFraction(terrainFraction);
+        setSeed(seed);
+        resizeGrid();
+        cells.resize(layout.size());
+        generateMaze();
+        reset();
+    }
+
+    /* Generate the maze that follows the recipe, e.g. on another thread */
+    explicit BasicMaze(const MazeRecipe& recipe)
+        : width(recipe.width), height(recipe.height), generator(recipe.generator),
+          threads(recipe.threads) {
+        loopFraction    = recipe.loopFraction;
+        terrainFraction = recipe.terrainFraction;
+        fieldEnabled    = recipe.fieldEnabled;
+        graphEnabled    = recipe.graphEnabled;
+        showHeatMap     = recipe.showHeatMap;
+        solver          = recipe.solver;
+        rng       = recipe.rng;
+        seed      = recipe.seed;
+        generated = recipe.generated;
+        resizeGrid();
+        cells.resize(layout.size());
+        generateMaze();
+        reset();
+        if (showHeatMap && !fieldValid) buildDistanceField();
+        if (usesJunctionGraph(solver) && !graphValid) buildJunctionGraph();
+    }
+
+    /* The recipe for the maze that would be generated after this one */
+    MazeRecipe recipe() const {
+        return {width, height, generator, threads, loopFraction, terrainFraction,
+                fieldEnabled, graphEnabled, showHeatMap, solver, rng, seed, generated};
+    }
+
+    /* Generate a perfect maze with the selected algorithm, then braid it
+     * and scatter terrain if enabled */
+    void generateMaze() {
+        beginGeneration();
+        runGeneration(0);
+    }
+
+    /* Progressive generation: beginGeneration() clears the grid and each
+     * continueGeneration() call carves for about budgetMicros (0 for no
+     * limit), so a frame loop can show the maze being built without ever
+     * blocking for long.  The maze is the one generateNewMaze() would
+     * make; it is reset and playable once continueGeneration() returns
+     * true.  The parallel (threads > 1) back-tracker carves all its tiles
+     * in one slice.  A Maze must not be moved while it is generating. */
+    void beginGeneration() {
+        sequence = generated++;
+        fieldValid = false;
+        graphValid = false;
+        perfect = true;
+        minStepCost = stepCost(PATH);
+        pathFound  = false;
+        autoMoving = false;
+        path.clear();
+        std::fill(cells.begin(), cells.end(), static_cast<uint8_t>(WALL));
+        markAllChanged();
+        if (generator != BACKTRACKER) {
+            /* Reuse the last row generator (and its row buffers) when the
+             * type and size match */
+            if (rowGenerator && rowGeneratorType == generator &&
+                rowGenerator->getWidth() == width && rowGenerator->getHeight() == height) {
+                rowGenerator->restart(rng);
+            } else {
+                rowGenerator = makeRowGenerator(generator, width, height, rng);
+                rowGeneratorType = generator;
+            }
+            generationRow = 0;
+            phase = GEN_ROWS;
+        } else if (threads > 1) {
+            phase = GEN_TILED;
+        } else {
+            /* Iterative back-tracking: the explicit stack is reserved up
+             * front and neighbours are gathered into a fixed array, so
+             * carving never allocates */
+            carveStack.reserve(static_cast<size_t>(width / 2) * (height / 2));
+            beginCarve(Vector2i(1, 1), carveStack);
+            phase = GEN_CARVE;
+        }
+    }
+
+    bool continueGeneration(double budgetMicros) {
+        if (phase == GEN_IDLE) return true;
+        runGeneration(budgetMicros);
+        if (phase != GEN_IDLE) {
+            markAllChanged();
+            return false;
+        }
+        reset();
+        return true;
+    }
+
+    void finishGeneration() { continueGeneration(0); }
+    bool isGenerating() const { return phase != GEN_IDLE; }
+
+    /* Open each dead end of room row y into a random neighbouring room with
+     * probability loopFraction, which adds loops; at 1 no dead ends remain */
+    void braidRow(int y) {
+        uint32_t threshold = static_cast<uint32_t>(loopFraction * UINT32_MAX);
+        Vector2i walls[4];
+        for (int x = 1; x < width - 1; x += 2) {
+            int open = 0, closed = 0;
+            for (int d = 0; d < 4; d++) {
+                int wx = x + DIRECTIONS[d].x, wy = y + DIRECTIONS[d].y;
+                if (typeAt(wx, wy) != WALL) {
+                    open++;
+                } else if (wx + DIRECTIONS[d].x > 0 && wx + DIRECTIONS[d].x < width - 1 &&
+                           wy + DIRECTIONS[d].y > 0 && wy + DIRECTIONS[d].y < height - 1) {
+                    walls[closed++] = Vector2i(wx, wy);
+                }
+            }
+            if (open != 1 || closed == 0 || rng() > threshold) continue;
+            Vector2i wall = walls[closed > 1 ? rng.below(closed) : 0];
+            setType(wall.x, wall.y, PATH);
+            perfect = false;
+        }
+    }
+
+    /* Turn a terrainFraction of the open cells of row y into mud or ice
+     * (half each), leaving the start and target cells plain */
+    void scatterTerrainRow(int y) {
+        uint32_t threshold = static_cast<uint32_t>(terrainFraction * UINT32_MAX);
+        for (int x = 1; x < width - 1; x++) {
+            if (typeAt(x, y) == WALL || rng() > threshold) continue;
+            if ((x == 1 && y == 1) || (x == width - 2 && y == height - 2)) continue;
+            bool mud = rng() & 1;
+            setType(x, y, mud ? MUD : ICE);
+            if (!mud) minStepCost = stepCost(ICE);
+        }
+    }
+
+    /* Parallel back-tracking: split the cells into one tile per thread, carve
+     * the tiles on generationPool() with an independent RNG stream each, then join
+     * the tiles along a random spanning tree (Kruskal with union-find over
+     * the tile borders) so the result is still a perfect maze. */
+    void generateTiled() {
+        std::fill(cells.begin(), cells.end(), static_cast<uint8_t>(WALL));
+
+        int columns = width / 2, rows = height / 2;
+        int tilesX = 1, tilesY = threads;
+        for (int f = 1; f * f <= threads; f++) {
+            if (threads % f == 0) { tilesX = f; tilesY = threads / f; }
+        }
+        if (columns > rows) std::swap(tilesX, tilesY);
+        tilesX = std::min(tilesX, columns);
+        tilesY = std::min(tilesY, rows);
+
+        /* Tile t covers cell columns [colStart[t % tilesX], colStart[t % tilesX + 1]) */
+        std::vector<int> colStart(tilesX + 1), rowStart(tilesY + 1);
+        for (int i = 0; i <= tilesX; i++) colStart[i] = columns * i / tilesX;
+        for (int i = 0; i <= tilesY; i++) rowStart[i] = rows * i / tilesY;
+
+        int tileCount = tilesX * tilesY;
+        std::vector<uint32_t> seeds(tileCount);
+        for (auto& seed : seeds) seed = rng();
+        {
+            std::lock_guard<std::mutex> lock(generationPoolMutex());
+            ThreadPool& pool = generationPool();
+            tileStacks.resize(pool.size());
+            pool.run(tileCount, [&](size_t i, int worker) {
+                int t = static_cast<int>(i);
+                Vector2i lo(2 * colStart[t % tilesX] + 1, 2 * rowStart[t / tilesX] + 1);
+                Vector2i hi(2 * colStart[t % tilesX + 1] - 1, 2 * rowStart[t / tilesX + 1] - 1);
+                Pcg32 tileRng(seeds[t], t);
+                carveBacktracker(lo, hi, tileRng, tileStacks[worker]);
+            });
+        }
+
+        /* Border edges between neighbouring tiles, in random order; the
+         * second member says whether the neighbour lies east (else south) */
+        std::vector<std::pair<int, bool>> edges;
+        for (int t = 0; t < tileCount; t++) {
+            if (t % tilesX + 1 < tilesX) edges.push_back(std::make_pair(t, true));
+            if (t / tilesX + 1 < tilesY) edges.push_back(std::make_pair(t, false));
+        }
+        shuffleWith(edges, rng);
+
+        std::vector<int> parent(tileCount);
+        for (int t = 0; t < tileCount; t++) parent[t] = t;
+        auto find = [&parent](int t) {
+            while (parent[t] != t) t = parent[t] = parent[parent[t]];
+            return t;
+        };
+
+        for (const auto& edge : edges) {
+            int tile = edge.first;
+            bool east = edge.second;
+            int a = find(tile), b = find(east ? tile + 1 : tile + tilesX);
+            if (a == b) continue;
+            parent[b] = a;
+
+            int tx = tile % tilesX, ty = tile / tilesX;
+            if (east) {
+                int row = rowStart[ty] + rng.below(rowStart[ty + 1] - rowStart[ty]);
+                setType(2 * colStart[tx + 1], 2 * row + 1, PATH);
+            } else {
+                int column = colStart[tx] + rng.below(colStart[tx + 1] - colStart[tx]);
+                setType(2 * column + 1, 2 * rowStart[ty + 1], PATH);
+            }
+        }
+    }
+
+    /* Carve a perfect maze over the cells in [lo, hi] (inclusive, odd grid
+     * coordinates) starting from lo.  Only cells inside the rectangle are
+     * read or written, so disjoint rectangles can be carved concurrently. */
+    void carveBacktracker(Vector2i lo, Vector2i hi, Pcg32& random,
+                          std::vector<Vector2i>& stack) {
+        stack.reserve(static_cast<size_t>((hi.x - lo.x) / 2 + 1) * ((hi.y - lo.y) / 2 + 1));
+        beginCarve(lo, stack);
+        carveSteps(lo, hi, random, stack, SIZE_MAX);
+    }
+
+    void beginCarve(Vector2i start, std::vector<Vector2i>& stack) {
+        setType(start.x, start.y, PATH);
+        stack.clear();
+        stack.push_back(start);
+        setVisited(start.x, start.y);
+    }
+
+    /* Run up to `steps` iterations of the back-tracker; true once done */
+    bool carveSteps(Vector2i lo, Vector2i hi, Pcg32& random, std::vector<Vector2i>& stack,
+                    size_t steps) {
+        Vector2i neighbors[4];
+        for (; steps > 0 && !stack.empty(); steps--) {
+            Vector2i current = stack.back();
+            int x = current.x;
+            int y = current.y;
+
+            int count = getUnvisitedNeighbors(x, y, lo, hi, neighbors);
+
+            if (count > 0) {
+                int pick = count > 1 ? static_cast<int>(random.below(count)) : 0;
+                Vector2i next = neighbors[pick];
+                int nx = next.x;
+                int ny = next.y;
+
+                int midX = (x + nx) / 2;
+                int midY = (y + ny) / 2;
+                setType(midX, midY, PATH);
+                setType(nx, ny, PATH);
+
+                setVisited(nx, ny);
+                stack.push_back(next);
+            } else {
+                stack.pop_back();
+            }
+        }
+        return stack.empty();
+    }
+
+    /* Reset player & target positions, clear visited flags */
+    void reset() {
+        if (isValidPosition(playerPos.x, playerPos.y) && typeAt(playerPos.x, playerPos.y) == PLAYER) {
+            setType(playerPos.x, playerPos.y, playerGround);
+        }
+        for (auto& cell : cells) {
+            cell &= CELL_TYPE_MASK;
+            if (cell == PLAYER) cell = PATH;
+        }
+
+        playerPos = Vector2i(1, 1);
+        playerGround = typeAt(playerPos.x, playerPos.y);
+        setType(playerPos.x, playerPos.y, PLAYER);
+
+        targetPos = Vector2i(width - 2, height - 2);
+        setType(targetPos.x, targetPos.y, TARGET);
+        if (fieldEnabled && !fieldValid) buildDistanceField();
+        if (graphEnabled && !graphValid) buildJunctionGraph();
+
+        pathFound  = false;
+        autoMoving = false;
+        markAllChanged();
+    }
+
+    void generateNewMaze() {
+        generateMaze();
+        reset();
+    }
+
+    /* Replace the grid with a w x h maze (odd sizes) built from its rooms,
+     * the cells at odd coordinates: open(rx, ry, east) tells whether the
+     * passage east (or else south) of room (rx, ry) is carved, and
+     * ground(rx, ry, slot) gives PATH, MUD or ICE for the room (slot 0)
+     * and its passage east (1) or south (2) */
+    template <typename Open, typename Ground>
+    void loadRooms(int w, int h, Open&& open, Ground&& ground) {
+        width  = w;
+        height = h;
+        resizeGrid();
+        cells.assign(layout.size(), WALL);
+        phase = GEN_IDLE;
+        rowGenerator.reset();
+        minStepCost = stepCost(PATH);
+        auto place = [&](int x, int y, CellType type) {
+            setType(x, y, type);
+            if (type == ICE) minStepCost = stepCost(ICE);
+        };
+        size_t rooms = 0, passages = 0;
+        for (int ry = 0; 2 * ry + 1 < height - 1; ry++) {
+            for (int rx = 0; 2 * rx + 1 < width - 1; rx++, rooms++) {
+                int x = 2 * rx + 1, y = 2 * ry + 1;
+                place(x, y, ground(rx, ry, 0));
+                if (x + 2 < width && open(rx, ry, true)) {
+                    place(x + 1, y, ground(rx, ry, 1));
+                    passages++;
+                }
+                if (y + 2 < height && open(rx, ry, false)) {
+                    place(x, y + 1, ground(rx, ry, 2));
+                    passages++;
+                }
+            }
+        }
+        /* A connected maze is perfect exactly when it is a tree */
+        perfect = passages + 1 == rooms;
+        fieldValid = false;
+        graphValid = false;
+        markAllChanged();
+        reset();
+    }
+
+    /* Show a grid that was not generated here, e.g. one level of a
+     * LevelMaze: cellAt(x, y) gives the CellType of every cell (the outer
+     * ring must be wall) and `shown` is drawn as the path.  The result is
+     * for drawing only; player and target are wherever the cells put them. */
+    template <typename CellAt>
+    void loadCells(int w, int h, CellAt&& cellAt, const std::vector<Vector2i>& shown) {
+        width  = w;
+        height = h;
+        resizeGrid();
+        cells.resize(layout.size());
+        phase = GEN_IDLE;
+        rowGenerator.reset();
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) cells[index(x, y)] = cellAt(x, y);
+        }
+        path.assign(shown.begin(), shown.end());
+        pathFound  = !path.empty();
+        autoMoving = false;
+        fieldValid = false;
+        graphValid = false;
+        markAllChanged();
+    }
+
+    /* Attempt to move the player by (dx, dy) */
+    bool movePlayer(int dx, int dy) {
+        int newX = playerPos.x + dx;
+        int newY = playerPos.y + dy;
+
+        if (isValidPosition(newX, newY) && typeAt(newX, newY) != WALL) {
+            placePlayer(Vector2i(newX, newY));
+            return true;
+        }
+        return false;
+    }
+
+    /* Move the player marker to an adjacent cell and record both cells as
+     * changed for the renderer */
+    void placePlayer(Vector2i newPos) {
+        Vector2i oldPos = playerPos;
+        setType(oldPos.x, oldPos.y, playerGround);
+        markChanged(oldPos.x, oldPos.y);
+        playerPos = newPos;
+        playerGround = typeAt(newPos.x, newPos.y);
+        setType(newPos.x, newPos.y, PLAYER);
+        markChanged(newPos.x, newPos.y);
+        if (pathFound) updatePathAfterMove(oldPos);
+    }
+
+    /* Keep the shown path valid after a one-cell move instead of solving
+     * again.  A step along the path just drops its first cell.  In a
+     * perfect maze the only other case is that the path now has to go
+     * back through the old cell (add it); `path` is stored target-first,
+     * so both are O(1).  With loops a step off the path needs a new solve. */
+    void updatePathAfterMove(Vector2i oldPos) {
+        if (!path.empty() && path.back() == playerPos) path.pop_back();
+        else if (perfect)                              path.push_back(oldPos);
+        else                                           findPath();
+    }
+
+    /* Find the shortest path from the player to the target with the
+     * selected solver, recording cells expanded and elapsed time */
+    void findPath() {
+        if (solver == SOLVER_DISTANCE_FIELD && !fieldValid) buildDistanceField();
+        if (usesJunctionGraph(solver) && !graphValid) buildJunctionGraph();
+        pathFound = solve(solver, playerPos, targetPos, playerScratch, path, lastSolve);
+        revision++;
+    }
+
+    /* Shortest path from `from` to `to` with the given solver.  `path` gets
+     * the cells target first, without `from`; false if `to` is unreachable.
+     * Every write goes to `scratch`, `path` and `stats`, so many threads can
+     * solve on one maze at once, each with its own scratch, as long as
+     * nothing modifies the maze meanwhile.  The field solver answers from
+     * the distance field when it was built for `to`, otherwise with BFS;
+     * the graph solvers fall back to BFS and A* without a junction graph. */
+    bool solve(SolverType type, Vector2i from, Vector2i to, SolverScratch& scratch,
+               std::vector<Vector2i>& path, SolveStats& stats) const {
+        ScopedTimer timer(STAT_SOLVE);
+        auto start = std::chrono::steady_clock::now();
+        path.clear();
+        stats.cellsExpanded = 0;
+        stats.queuePeak = 0;
+        bool found = isOpenCell(from) && isOpenCell(to) &&
+                     runSolver(type, from, to, scratch, path, stats);
+        stats.solver = type;
+        stats.microseconds = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count();
+        stats.pathCost = 0;
+        for (const Vector2i& pos : path) stats.pathCost += groundCost(index(pos.x, pos.y));
+        recordSolveCounters(stats.cellsExpanded, stats.queuePeak);
+        return found;
+    }
+
+    /* One BFS from the target gives every open cell its distance and the
+     * direction that leads one step closer.  This answers all "shortest
+     * path from X" queries (in steps; terrain is ignored) until the maze is
+     * regenerated.  With a backend set, it computes the distances and
+     * only the directions are derived here. */
+    void buildDistanceField() {
+        if (fieldBackend && buildFieldOnBackend()) return;
+        distances.assign(cells.size(), UNREACHABLE);
+        fieldDirs.resize((cells.size() + 3) / 4);
+        RingQueue<Vector2i>& queue = playerScratch.queue;
+        queue.clear();
+
+        distances[index(targetPos.x, targetPos.y)] = 0;
+        queue.push(targetPos);
+        maxDistance = 0;
+
+        while (!queue.empty()) {
+            Vector2i current = queue.front();
+            queue.pop();
+            size_t here = index(current.x, current.y);
+            uint32_t next = distances[here] + 1;
+
+            for (int d = 0; d < 4; d++) {
+                size_t i = neighborIndex(here, current, d);
+                if (distances[i] != UNREACHABLE || typeAtIndex(i) == WALL) continue;
+                distances[i] = next;
+                setPackedDir(fieldDirs, i, d);
+                queue.push(Vector2i(current.x + DIRECTIONS[d].x, current.y + DIRECTIONS[d].y));
+            }
+            maxDistance = std::max(maxDistance, next - 1);
+        }
+        fieldValid = true;
+        markAllChanged();
+    }
+
+    /* Reduce the maze to a JunctionGraph.  Edge costs use the ground under
+     * the player, so the graph stays valid while the player moves; it is
+     * rebuilt only after the maze is regenerated or loaded. */
+    void buildJunctionGraph() {
+        graph.nodes.clear();
+        graph.rowStart.assign(height + 1, 0);
+        graph.firstEdge.clear();
+        uint32_t edgeCount = 0;
+        for (int y = 0; y < height; y++) {
+            graph.rowStart[y] = graph.nodeCount();
+            if (y == 0 || y == height - 1) continue;
+            for (int x = 1; x < width - 1; x++) {
+                size_t i = index(x, y);
+                if (typeAtIndex(i) == WALL) continue;
+                int degree = openDegree(i, Vector2i(x, y));
+                if (degree == 2) continue;
+                graph.nodes.push_back({i, Vector2i(x, y)});
+                graph.firstEdge.push_back(edgeCount);
+                edgeCount += degree;
+            }
+        }
+        graph.rowStart[height] = graph.nodeCount();
+        graph.firstEdge.push_back(edgeCount);
+
+        /* Walk each corridor once and fill in the edges of both its ends */
+        graph.edges.assign(edgeCount, {JunctionGraph::NONE, 0, 0, 0});
+        for (uint32_t n = 0; n < graph.nodeCount(); n++) {
+            const JunctionGraph::Node& node = graph.nodes[n];
+            for (int d = 0; d < 4; d++) {
+                if (typeAtIndex(neighborIndex(node.cell, node.pos, d)) == WALL) continue;
+                JunctionGraph::Edge& edge = graph.edges[edgeSlot(n, d)];
+                if (edge.to != JunctionGraph::NONE) continue;
+                uint32_t length = 0, cost = 0;
+                int last = d;
+                Vector2i end = walkCorridor(node.pos, d, [&](Vector2i, size_t i, int k) {
+                    length++;
+                    cost += groundCost(i);
+                    last = k;
+                    return false;
+                });
+                uint32_t m = graph.nodeAt(end);
+                edge = {m, length, cost, uint8_t(d)};
+                uint32_t back = cost - groundCost(graph.nodes[m].cell) + groundCost(node.cell);
+                graph.edges[edgeSlot(m, last ^ 1)] = {n, length, back, uint8_t(last ^ 1)};
+            }
+        }
+        graphValid = true;
+    }
+
+    /* Build the junction graph after every generation (the graph solvers
+     * otherwise build it on first use) */
+    void setJunctionGraphEnabled(bool enabled) {
+        graphEnabled = enabled;
+        if (enabled && !graphValid) buildJunctionGraph();
+    }
+    bool hasJunctionGraph() const { return graphValid; }
+    const JunctionGraph& getJunctionGraph() const { return graph; }
+
+    /* Called on the thread that builds the field; not part of the recipe,
+     * so a maze moved in from a MazePrefetcher needs it set again */
+    void setDistanceFieldBackend(DistanceFieldBackend* backend) { fieldBackend = backend; }
+
+    /* Shortest-path length from `from` to the target, UNREACHABLE for walls
+     * and disconnected cells; builds the field on first use */
+    uint32_t distanceToTarget(Vector2i from) {
+        if (!fieldValid) buildDistanceField();
+        return distances[index(from.x, from.y)];
+    }
+
+    /* Append the path from `from` to the target (excluding `from`) to out
+     * by following the field; false if the target cannot be reached */
+    bool queryPath(Vector2i from, std::vector<Vector2i>& out) {
+        if (!fieldValid) buildDistanceField();
+        return followField(from, out);
+    }
+
+    void setDistanceFieldEnabled(bool enabled) {
+        fieldEnabled = enabled;
+        if (enabled && !fieldValid) buildDistanceField();
+    }
+    bool isHeatMapShown() const { return showHeatMap; }
+    void setHeatMapShown(bool shown) {
+        showHeatMap = shown;
+        revision++;
+        if (shown && !fieldValid) buildDistanceField();
+    }
+
+    /* Prepare the animated auto-solve.  The animation walks `path` itself:
+     * each step moves to path.back(), which placePlayer() then pops, so
+     * nothing is copied. */
+    void prepareAutoMove() {
+        findPath();
+        autoMoving = pathFound;
+    }
+
+    /* Execute one step of the auto-solve animation */
+    bool autoMoveStep() {
+        if (!autoMoving || !pathFound || path.empty()) {
+            autoMoving = false;
+            return false;
+        }
+        ScopedTimer timer(STAT_AUTO_MOVE);
+
+        placePlayer(path.back());
+
+        if (playerPos == targetPos) autoMoving = false;
+        return true;
+    }
+
+    /* Take up to `steps` auto-solve steps at once; returns how many were
+     * taken.  The renderers see them as one batch of cell changes. */
+    size_t autoMoveSteps(size_t steps) {
+        size_t taken = 0;
+        while (taken < steps && autoMoveStep()) taken++;
+        return taken;
+    }
+
+    bool isAutoMoving() const { return autoMoving; }
+    GeneratorType getGenerator() const { return generator; }
+    void setGenerator(GeneratorType type) { generator = type; }
+    /* Threads used by the back-tracker; more than one switches to tiled
+     * generation.  Capped at hardwareThreads(), the size of generationPool(). */
+    void setThreads(int count) { threads = clampThreads(count); }
+    static int clampThreads(int count) { return std::min(hardwareThreads(), std::max(1, count)); }
+    SolverType getSolver() const { return solver; }
+    void setSolver(SolverType type) { solver = type; }
+    const SolveStats& getLastSolveStats() const { return lastSolve; }
+    int  getWidth()  const { return width; }
+    int  getHeight() const { return height; }
+    void setSeed(uint32_t value) {
+        rng.seed(value);
+        seed = value;
+        generated = 0;
+    }
+    /* Make the current maze number `value` of its seed, e.g. for one loaded
+     * from a file, with `random` the RNG as generating it left it, so the
+     * next maze continues the sequence */
+    void setSequence(uint32_t value, const Pcg32& random) {
+        rng = random;
+        sequence  = value;
+        generated = value + 1;
+    }
+    const Pcg32& getRng() const { return rng; }
+    /* The current maze is number getSequence() (from 0) generated since
+     * the RNG was seeded with getSeed() */
+    uint32_t getSeed() const { return seed; }
+    uint32_t getSequence() const { return sequence; }
+    int  getThreads() const { return threads; }
+    /* Braiding and terrain apply from the next generated maze */
+    void setLoopFraction(double fraction) { loopFraction = std::min(1.0, std::max(0.0, fraction)); }
+    void setTerrainFraction(double fraction) { terrainFraction = std::min(1.0, std::max(0.0, fraction)); }
+    double getLoopFraction() const { return loopFraction; }
+    double getTerrainFraction() const { return terrainFraction; }
+    /* False once the maze has loops, i.e. more than one path between cells */
+    bool isPerfect() const { return perfect; }
+
+    /* Change tracking for renderers.  The version is bumped whenever any
+     * number of cells may have changed; single-cell edits made since then
+     * are listed in the change log, so a renderer that remembers the
+     * version and how much of the log it has seen can update only those.
+     * Log entries are row-major (y * width + x) whatever the layout. */
+    uint64_t getVersion() const { return version; }
+    const std::vector<uint32_t>& getChangeLog() const { return changeLog; }
+    /* Bumped on every change visible on screen: cells, the shown path or
+     * the heat-map flag.  Equal revisions mean a frame can be skipped. */
+    uint64_t getRevision() const { return revision; }
+
+    /* Read-only state used by the renderer.  cellData() and distanceAt()
+     * are in layout order: cell (x, y) is at cellIndex(x, y). */
+    const uint8_t* cellData() const { return cells.data(); }
+    size_t cellIndex(int x, int y) const { return index(x, y); }
+    CellType cellType(int x, int y) const { return typeAt(x, y); }
+    /* cellType(), but the terrain under the player for its cell */
+    CellType groundType(int x, int y) const {
+        CellType type = typeAt(x, y);
+        return type == PLAYER ? playerGround : type;
+    }
+    bool hasPath() const { return pathFound; }
+    const std::vector<Vector2i>& getPath() const { return path; }
+    bool hasDistanceField() const { return fieldValid; }
+    static bool usesJunctionGraph(SolverType type) {
+        return type == SOLVER_GRAPH || type == SOLVER_GRAPH_ASTAR;
+    }
+    /* Solvers that answer from a distance field or junction graph built
+     * beforehand, and without one only fall back to another search */
+    static bool usesPrecomputed(SolverType type) {
+        return type == SOLVER_DISTANCE_FIELD || usesJunctionGraph(type);
+    }
+    uint32_t getMaxDistance() const { return maxDistance; }
+    uint32_t distanceAt(size_t i) const { return distances[i]; }
+
+    static int normalizeSize(int n) {
+        if (n < 5) n = 5;
+        return n | 1;
+    }
+
+    friend class MazeBench;
+
+private:
+    int width;
+    int height;
+    Layout layout;
+    std::vector<uint8_t> cells; // one byte per cell in layout order, layout.size() bytes
+    std::vector<uint8_t> rowBuffer; // a generated row on its way into a non-row-major layout
+    GeneratorType generator;
+    int threads = 1;
+    std::vector<Vector2i> path; // target first, so the next step is path.back()
+    std::vector<Vector2i> carveStack; // kept between runs to reuse its storage
+    std::vector<std::vector<Vector2i>> tileStacks; // carveStack of each generationPool() worker
+    GenerationPhase phase = GEN_IDLE;
+    std::unique_ptr<RowGenerator> rowGenerator; // holds a pointer to rng while generating
+    GeneratorType rowGeneratorType = BACKTRACKER;
+    int generationRow = 0;            // next row of GEN_ROWS, GEN_BRAID or GEN_TERRAIN
+    SolverScratch playerScratch;      // for findPath() and the distance field
+
+    SolverType solver = SOLVER_BFS;
+    SolveStats lastSolve;
+
+    std::vector<uint32_t> distances; // steps to the target per cell
+    std::vector<uint8_t>  fieldDirs; // 2-bit direction towards the target
+    uint32_t maxDistance  = 0;
+    bool     fieldValid   = false;   // cleared whenever the maze is regenerated
+    bool     fieldEnabled = false;   // rebuild eagerly after generation
+    DistanceFieldBackend* fieldBackend = nullptr;
+    JunctionGraph graph;
+    bool     graphValid   = false;   // like fieldValid
+    bool     graphEnabled = false;
+    bool     showHeatMap  = false;
+
+    uint64_t version  = 0;
+    uint64_t revision = 0;
+    std::vector<uint32_t> changeLog; // cells edited since `version` was bumped
+    Vector2i playerPos;
+    Vector2i targetPos;
+    CellType playerGround = PATH; // terrain under the player
+    double   loopFraction    = 0; // share of dead ends opened by braidRow()
+    double   terrainFraction = 0; // share of open cells turned to mud or ice
+    bool     perfect     = true;  // exactly one path between any two cells
+    uint32_t minStepCost = 2;     // cheapest stepCost() in the maze, for A*
+    bool pathFound  = false;
+    bool autoMoving = false;
+    Pcg32 rng;
+    uint32_t seed      = 0;
+    uint32_t generated = 0; // mazes generated since seeding
+    uint32_t sequence  = 0;
+
+    ptrdiff_t neighborOffsets[4] = {}; // index steps of DIRECTIONS in the row-major layout
+
+    size_t   index(int x, int y) const { return layout.index(x, y); }
+    CellType typeAt(int x, int y) const {
+        return static_cast<CellType>(cells[index(x, y)] & CELL_TYPE_MASK);
+    }
+    void setType(int x, int y, CellType type) {
+        uint8_t& cell = cells[index(x, y)];
+        cell = (cell & ~CELL_TYPE_MASK) | type;
+    }
+    /* Versions are unique across Maze objects, so a renderer switched to
+     * another maze of the same size never mistakes it for the old one */
+    static uint64_t nextVersion() {
+        static std::atomic<uint64_t> counter(0);
+        return ++counter;
+    }
+    void markAllChanged() {
+        version = nextVersion();
+        revision++;
+        changeLog.clear();
+    }
+    void markChanged(int x, int y) {
+        revision++;
+        if (changeLog.size() >= cells.size() / 8 + 64) markAllChanged();
+        else changeLog.push_back(static_cast<uint32_t>(static_cast<size_t>(y) * width + x));
+    }
+
+    /* Work the current phase until it is done or the budget runs out; the
+     * clock is read once per carve batch or row */
+    void runGeneration(double budgetMicros) {
+        ScopedTimer timer(STAT_GENERATE);
+        const size_t CARVE_BATCH = 1024;
+        auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                            std::chrono::duration<double, std::micro>(budgetMicros));
+        while (phase != GEN_IDLE) {
+            switch (phase) {
+                case GEN_CARVE:
+                    if (carveSteps(Vector2i(1, 1), Vector2i(width - 2, height - 2), rng, carveStack,
+                                   CARVE_BATCH)) finishPhase();
+                    break;
+                case GEN_TILED:
+                    generateTiled();
+                    finishPhase();
+                    break;
+                case GEN_ROWS:
+                    if (Layout::ROW_MAJOR) {
+                        if (rowGenerator->nextRow(cells.data() + index(0, generationRow))) generationRow++;
+                        else finishPhase();
+                    } else {
+                        rowBuffer.resize(width);
+                        if (!rowGenerator->nextRow(rowBuffer.data())) {
+                            finishPhase();
+                            break;
+                        }
+                        for (int x = 0; x < width; x++) cells[index(x, generationRow)] = rowBuffer[x];
+                        generationRow++;
+                    }
+                    break;
+                case GEN_BRAID:
+                    braidRow(generationRow);
+                    generationRow += 2;
+                    if (generationRow >= height - 1) finishPhase();
+                    break;
+                case GEN_TERRAIN:
+                    scatterTerrainRow(generationRow);
+                    generationRow++;
+                    if (generationRow >= height - 1) finishPhase();
+                    break;
+                default:
+                    break;
+            }
+            if (budgetMicros > 0 && std::chrono::steady_clock::now() >= deadline) return;
+        }
+    }
+
+    /* Move on to braiding, then terrain, skipping disabled steps */
+    void finishPhase() {
+        if (phase < GEN_BRAID && loopFraction > 0) {
+            phase = GEN_BRAID;
+        } else if (phase < GEN_TERRAIN && terrainFraction > 0) {
+            phase = GEN_TERRAIN;
+        } else {
+            phase = GEN_IDLE;
+        }
+        generationRow = 1;
+    }
+
+    void setVisited(int x, int y) { cells[index(x, y)] |= CELL_VISITED; }
+
+    bool isValidPosition(int x, int y) const {
+        return x >= 0 && x < width && y >= 0 && y < height;
+    }
+
+    /* Every generator and loadRooms() keep the outer ring of cells solid
+     * wall, so an open cell is never on the border and its neighbours are
+     * always inside the grid: the search loops rely on this sentinel ring
+     * instead of checking bounds.  solve() only lets open cells in. */
+    bool isOpenCell(Vector2i pos) const {
+        return isValidPosition(pos.x, pos.y) && typeAt(pos.x, pos.y) != WALL;
+    }
+    CellType typeAtIndex(size_t i) const { return static_cast<CellType>(cells[i] & CELL_TYPE_MASK); }
+
+    /* index() of the cell `steps` cells from pos (at index i) in direction
+     * d: a fixed offset in the row-major layout, a lookup in the others */
+    size_t neighborIndex(size_t i, Vector2i pos, int d, int steps = 1) const {
+        if (Layout::ROW_MAJOR) return i + steps * neighborOffsets[d];
+        return index(pos.x + steps * DIRECTIONS[d].x, pos.y + steps * DIRECTIONS[d].y);
+    }
+
+    void resizeGrid() {
+        layout.resize(width, height);
+        for (int d = 0; d < 4; d++) neighborOffsets[d] = ptrdiff_t(DIRECTIONS[d].y) * width + DIRECTIONS[d].x;
+    }
+
+    /* Direction (index into DIRECTIONS) stored in 2 bits per cell */
+    static int packedDir(const std::vector<uint8_t>& dirs, size_t i) {
+        return (dirs[i >> 2] >> ((i & 3) * 2)) & 3;
+    }
+    static void setPackedDir(std::vector<uint8_t>& dirs, size_t i, int d) {
+        uint8_t& packed = dirs[i >> 2];
+        int shift = (i & 3) * 2;
+        packed = (packed & ~(3 << shift)) | (d << shift);
+    }
+
+    /* Dispatch for solve(); from and to are open cells */
+    bool runSolver(SolverType type, Vector2i from, Vector2i to, SolverScratch& scratch,
+                   std::vector<Vector2i>& path, SolveStats& stats) const {
+        bool found;
+        switch (type) {
+            case SOLVER_BIDIRECTIONAL:
+                found = solveBidirectional(from, to, scratch, path, stats);
+                stats.queuePeak = scratch.queue.peak() + scratch.queueBack.peak();
+                break;
+            case SOLVER_ASTAR:
+            case SOLVER_DIJKSTRA:
+                found = solveWeighted(type == SOLVER_ASTAR, from, to, scratch, path, stats);
+                stats.queuePeak = scratch.openBuckets.peak();
+                break;
+            case SOLVER_BITBOARD:
+                found = solveBitboard(from, to, scratch, path, stats);
+                stats.queuePeak = scratch.bitboard.largestFrontier();
+                break;
+            case SOLVER_DISTANCE_FIELD:
+                if (fieldValid && to == targetPos) {
+                    found = solveFromField(from, path, stats);
+                    break;
+                }
+                found = solveBFS(from, to, scratch, path, stats);
+                stats.queuePeak = scratch.queue.peak();
+                break;
+            case SOLVER_GRAPH:
+            case SOLVER_GRAPH_ASTAR:
+                if (graphValid) {
+                    found = solveJunction(type == SOLVER_GRAPH_ASTAR, from, to, scratch, path, stats);
+                } else if (type == SOLVER_GRAPH_ASTAR) {
+                    found = solveWeighted(true, from, to, scratch, path, stats);
+                    stats.queuePeak = scratch.openBuckets.peak();
+                } else {
+                    found = solveBFS(from, to, scratch, path, stats);
+                    stats.queuePeak = scratch.queue.peak();
+                }
+                break;
+            default:
+                found = solveBFS(from, to, scratch, path, stats);
+                stats.queuePeak = scratch.queue.peak();
+                break;
+        }
+        return found;
+    }
+
+    /* Breadth-First Search.  Predecessors are stored as 2-bit arrival
+     * directions and the frontier lives in a ring buffer; both are kept in
+     * the scratch, so a solve on a maze of unchanged size performs no
+     * allocations. */
+    bool solveBFS(Vector2i from, Vector2i to, SolverScratch& scratch,
+                  std::vector<Vector2i>& path, SolveStats& stats) const {
+        scratch.prepare(cells.size());
+        RingQueue<Vector2i>& queue = scratch.queue;
+        queue.push(from);
+        scratch.marks[index(from.x, from.y)] = SCRATCH_REACHED;
+
+        while (!queue.empty()) {
+            Vector2i current = queue.front();
+            queue.pop();
+            stats.cellsExpanded++;
+
+            if (current == to) {
+                reconstructPath(scratch, from, to, path);
+                return true;
+            }
+
+            size_t here = index(current.x, current.y);
+            for (int d = 0; d < 4; d++) {
+                size_t i = neighborIndex(here, current, d);
+                if (scratch.marks[i] || typeAtIndex(i) == WALL) continue;
+                scratch.marks[i] = SCRATCH_REACHED;
+                queue.push(Vector2i(current.x + DIRECTIONS[d].x, current.y + DIRECTIONS[d].y));
+                setPackedDir(scratch.parentDirs, i, d);
+            }
+        }
+        return false;
+    }
+
+    /* Bit-parallel BFS; the scratch packs the open plane again only after
+     * the maze changed */
+    bool solveBitboard(Vector2i from, Vector2i to, SolverScratch& scratch,
+                       std::vector<Vector2i>& path, SolveStats& stats) const {
+        if (scratch.bitboardVersion != version) {
+            if (Layout::ROW_MAJOR) {
+                scratch.bitboard.load(cells.data(), width, height);
+            } else {
+                scratch.row.resize(width);
+                scratch.bitboard.resize(width, height);
+                for (int y = 0; y < height; y++) {
+                    for (int x = 0; x < width; x++) scratch.row[x] = cells[index(x, y)];
+                    scratch.bitboard.loadRow(scratch.row.data(), y);
+                }
+            }
+            scratch.bitboardVersion = version;
+        }
+        bool found = scratch.bitboard.solve(from, to);
+        path = scratch.bitboard.getPath();
+        stats.cellsExpanded = scratch.bitboard.cellsExpanded();
+        return found;
+    }
+
+    /* Bidirectional BFS: grow one search from `from` and one from `to`,
+     * always expanding a whole layer of the smaller frontier, and stop when
+     * they touch.  Meetings are detected as soon as a cell is discovered,
+     * so every meeting found within a layer has the same length. */
+    bool solveBidirectional(Vector2i from, Vector2i to, SolverScratch& scratch,
+                            std::vector<Vector2i>& path, SolveStats& stats) const {
+        scratch.prepare(cells.size());
+        if (from == to) return true;
+        scratch.queue.push(from);
+        scratch.marks[index(from.x, from.y)] = SCRATCH_REACHED;
+        scratch.queueBack.push(to);
+        scratch.marks[index(to.x, to.y)] = SCRATCH_REACHED_BACK;
+
+        while (!scratch.queue.empty() && !scratch.queueBack.empty()) {
+            bool forward = scratch.queue.size() <= scratch.queueBack.size();
+            RingQueue<Vector2i>& queue = forward ? scratch.queue : scratch.queueBack;
+            uint8_t mine   = forward ? SCRATCH_REACHED : SCRATCH_REACHED_BACK;
+            uint8_t theirs = forward ? SCRATCH_REACHED_BACK : SCRATCH_REACHED;
+
+            for (size_t layer = queue.size(); layer > 0; layer--) {
+                Vector2i current = queue.front();
+                queue.pop();
+                stats.cellsExpanded++;
+
+                size_t here = index(current.x, current.y);
+                for (int d = 0; d < 4; d++) {
+                    size_t i = neighborIndex(here, current, d);
+                    if (typeAtIndex(i) == WALL) continue;
+
+                    uint8_t mark = scratch.marks[i];
+                    Vector2i next(current.x + DIRECTIONS[d].x, current.y + DIRECTIONS[d].y);
+                    if (mark & theirs) {
+                        if (forward) reconstructMeeting(scratch, from, to, current, next, path);
+                        else         reconstructMeeting(scratch, from, to, next, current, path);
+                        return true;
+                    }
+                    if (mark & mine) continue;
+
+                    scratch.marks[i] = mine;
+                    queue.push(next);
+                    setPackedDir(scratch.parentDirs, i, d);
+                }
+            }
+        }
+        return false;
+    }
+
+    /* Dijkstra, or A* with the Manhattan distance times the cheapest step
+     * as heuristic, over the terrain step costs.  Costs are small integers,
+     * so the open list is a bucket queue; among equal keys it pops the
+     * newest entry, which makes A* dive along corridors.  Stale entries are
+     * skipped when popped. */
+    bool solveWeighted(bool useHeuristic, Vector2i from, Vector2i to, SolverScratch& scratch,
+                       std::vector<Vector2i>& path, SolveStats& stats) const {
+        scratch.prepare(cells.size());
+        scratch.gScore.resize(cells.size());
+        BucketQueue<CostEntry>& open = scratch.openBuckets;
+        open.reset(2 * MAX_STEP_COST + 1);
+
+        size_t start = index(from.x, from.y);
+        scratch.gScore[start] = 0;
+        scratch.marks[start] = SCRATCH_REACHED;
+        open.push(useHeuristic ? heuristic(from, to) : 0, {0, from});
+
+        while (!open.empty()) {
+            uint32_t key;
+            CostEntry entry = open.pop(key);
+
+            Vector2i current = entry.pos;
+            size_t here = index(current.x, current.y);
+            if (entry.g > scratch.gScore[here]) continue;
+            stats.cellsExpanded++;
+
+            if (current == to) {
+                reconstructPath(scratch, from, to, path);
+                return true;
+            }
+
+            for (int d = 0; d < 4; d++) {
+                size_t i = neighborIndex(here, current, d);
+                if (typeAtIndex(i) == WALL) continue;
+
+                /* The terrain under the player, as the graph solvers charge it */
+                uint32_t g = entry.g + groundCost(i);
+                if (scratch.marks[i] && scratch.gScore[i] <= g) continue;
+
+                scratch.marks[i] = SCRATCH_REACHED;
+                scratch.gScore[i] = g;
+                setPackedDir(scratch.parentDirs, i, d);
+                Vector2i next(current.x + DIRECTIONS[d].x, current.y + DIRECTIONS[d].y);
+                open.push(useHeuristic ? g + heuristic(next, to) : g, {g, next});
+            }
+        }
+        return false;
+    }
+
+    /* Answer a query towards targetPos from the precomputed field */
+    bool solveFromField(Vector2i from, std::vector<Vector2i>& path, SolveStats& stats) const {
+        bool found = followField(from, path);
+        std::reverse(path.begin(), path.end());
+        stats.cellsExpanded = path.size();
+        return found;
+    }
+
+    /* Append the cells from `from` to the target (excluding `from`) by
+     * following a valid field */
+    bool followField(Vector2i from, std::vector<Vector2i>& out) const {
+        if (distances[index(from.x, from.y)] == UNREACHABLE) return false;
+        Vector2i current = from;
+        while (!(current == targetPos)) {
+            const Vector2i& dir = DIRECTIONS[packedDir(fieldDirs, index(current.x, current.y))];
+            current = Vector2i(current.x - dir.x, current.y - dir.y);
+            out.push_back(current);
+        }
+        return true;
+    }
+
+    /* `path` runs from `to` back to the cell next to `from` */
+    void reconstructPath(const SolverScratch& scratch, Vector2i from, Vector2i to,
+                         std::vector<Vector2i>& path) const {
+        ScopedTimer timer(STAT_RECONSTRUCT);
+        Vector2i current = to;
+        while (!(current == from)) {
+            path.push_back(current);
+            const Vector2i& dir = DIRECTIONS[packedDir(scratch.parentDirs, index(current.x, current.y))];
+            current = Vector2i(current.x - dir.x, current.y - dir.y);
+        }
+    }
+
+    /* Join the two halves of a bidirectional search: `fromStart` was
+     * reached from `from` and `fromGoal` from `to` */
+    void reconstructMeeting(const SolverScratch& scratch, Vector2i from, Vector2i to,
+                            Vector2i fromStart, Vector2i fromGoal,
+                            std::vector<Vector2i>& path) const {
+        ScopedTimer timer(STAT_RECONSTRUCT);
+        Vector2i current = fromGoal;
+        path.push_back(current);
+        while (!(current == to)) {
+            const Vector2i& dir = DIRECTIONS[packedDir(scratch.parentDirs, index(current.x, current.y))];
+            current = Vector2i(current.x - dir.x, current.y - dir.y);
+            path.push_back(current);
+        }
+        std::reverse(path.begin(), path.end());
+
+        current = fromStart;
+        while (!(current == from)) {
+            path.push_back(current);
+            const Vector2i& dir = DIRECTIONS[packedDir(scratch.parentDirs, index(current.x, current.y))];
+            current = Vector2i(current.x - dir.x, current.y - dir.y);
+        }
+    }
+
+    /* Shortest path over the junction graph: fewest steps, or lowest
+     * terrain cost when `weighted`, by A* over the node positions.  A start
+     * or goal inside a corridor joins the search through the nodes at both
+     * ends of its corridor; the goal is then an extra node numbered
+     * nodeCount().  Only the corridors of the path found are walked. */
+    bool solveJunction(bool weighted, Vector2i from, Vector2i to, SolverScratch& scratch,
+                       std::vector<Vector2i>& path, SolveStats& stats) const {
+        if (from == to) return true;
+        const uint32_t nodeCount = graph.nodeCount();
+        const uint32_t source = nodeCount + 1; // parent of nodes reached from `from`
+        uint32_t goal = graph.nodeAt(to);
+        bool goalInCorridor = goal == JunctionGraph::NONE;
+        if (goalInCorridor) goal = nodeCount;
+
+        scratch.nodeG.assign(nodeCount + 1, UNREACHABLE);
+        scratch.nodeParent.resize(nodeCount + 1);
+        scratch.nodeDir.resize(nodeCount + 1);
+        std::vector<GraphEntry>& open = scratch.graphHeap;
+        open.clear();
+        uint32_t scale = weighted ? minStepCost : 1;
+
+        auto reach = [&](uint32_t node, uint32_t g, uint32_t parent, int dir) {
+            if (g >= scratch.nodeG[node]) return;
+            scratch.nodeG[node] = g;
+            scratch.nodeParent[node] = parent;
+            scratch.nodeDir[node] = static_cast<uint8_t>(dir);
+            Vector2i pos = node == nodeCount ? to : graph.nodes[node].pos;
+            uint32_t h = scale * (std::abs(pos.x - to.x) + std::abs(pos.y - to.y));
+            open.push_back({g + h, g, node});
+            std::push_heap(open.begin(), open.end(), std::greater<GraphEntry>());
+            stats.queuePeak = std::max(stats.queuePeak, open.size());
+        };
+
+        /* Links from the nodes at the ends of the goal's corridor */
+        struct Link { uint32_t node, g; int dir; } links[4];
+        int linkCount = 0;
+        if (goalInCorridor) {
+            size_t goalCell = index(to.x, to.y);
+            for (int d = 0; d < 4; d++) {
+                if (typeAtIndex(neighborIndex(goalCell, to, d)) == WALL) continue;
+                uint32_t length = 0, cost = 0;
+                int last = d;
+                Vector2i end = walkCorridor(to, d, [&](Vector2i pos, size_t i, int k) {
+                    length++;
+                    cost += groundCost(i);
+                    last = k;
+                    return pos == to;
+                });
+                if (end == to) continue; // a loop without nodes
+                /* Walking towards the goal enters the goal instead of the node */
+                cost += groundCost(goalCell) - groundCost(index(end.x, end.y));
+                links[linkCount++] = {graph.nodeAt(end), weighted ? cost : length, last ^ 1};
+            }
+        }
+
+        /* Seed the search from `from` or the ends of its corridor */
+        uint32_t start = graph.nodeAt(from);
+        if (start != JunctionGraph::NONE) {
+            reach(start, 0, source, 0);
+        } else {
+            size_t fromCell = index(from.x, from.y);
+            for (int d = 0; d < 4; d++) {
+                if (typeAtIndex(neighborIndex(fromCell, from, d)) == WALL) continue;
+                uint32_t length = 0, cost = 0;
+                bool stopped = false;
+                Vector2i end = walkCorridor(from, d, [&](Vector2i pos, size_t i, int) {
+                    length++;
+                    cost += groundCost(i);
+                    stopped = pos == from || (goalInCorridor && pos == to);
+                    return stopped;
+                });
+                if (!stopped) reach(graph.nodeAt(end), weighted ? cost : length, source, d);
+                else if (end == to) reach(goal, weighted ? cost : length, source, d);
+            }
+        }
+
+        while (!open.empty()) {
+            std::pop_heap(open.begin(), open.end(), std::greater<GraphEntry>());
+            GraphEntry entry = open.back();
+            open.pop_back();
+            uint32_t n = entry.node;
+            if (entry.g > scratch.nodeG[n]) continue;
+            stats.cellsExpanded++;
+
+            if (n == goal) {
+                expandJunctionPath(scratch, from, to, goal, path);
+                return true;
+            }
+            if (n == nodeCount) continue;
+            for (uint32_t e = graph.firstEdge[n]; e < graph.firstEdge[n + 1]; e++) {
+                const JunctionGraph::Edge& edge = graph.edges[e];
+                reach(edge.to, entry.g + (weighted ? edge.cost : edge.length), n, edge.dir);
+            }
+            for (int k = 0; k < linkCount; k++) {
+                if (links[k].node == n) reach(goal, entry.g + links[k].g, n, links[k].dir);
+            }
+        }
+        return false;
+    }
+
+    /* Walk the corridors from `from` to the goal node of a junction search
+     * into `path`, target first */
+    void expandJunctionPath(SolverScratch& scratch, Vector2i from, Vector2i to, uint32_t goal,
+                            std::vector<Vector2i>& path) const {
+        ScopedTimer timer(STAT_RECONSTRUCT);
+        const uint32_t nodeCount = graph.nodeCount();
+        scratch.segments.clear();
+        for (uint32_t n = goal; n <= nodeCount;) {
+            uint32_t parent = scratch.nodeParent[n];
+            GraphSegment segment = {parent > nodeCount ? from : graph.nodes[parent].pos,
+                                    n == nodeCount ? to : graph.nodes[n].pos, scratch.nodeDir[n]};
+            if (segment.start == segment.end) break; // `from` is the first node
+            scratch.segments.push_back(segment);
+            n = parent;
+        }
+        for (size_t s = scratch.segments.size(); s-- > 0;) {
+            const GraphSegment& segment = scratch.segments[s];
+            walkCorridor(segment.start, segment.dir, [&](Vector2i pos, size_t, int) {
+                path.push_back(pos);
+                return pos == segment.end;
+            });
+        }
+        std::reverse(path.begin(), path.end());
+    }
+
+    /* buildDistanceField() through fieldBackend: the backend sees a
+     * row-major grid, and each cell's direction is the first one that
+     * leads to a neighbour one step closer */
+    bool buildFieldOnBackend() {
+        size_t count = size_t(width) * height;
+        std::vector<uint8_t>  gathered;
+        std::vector<uint32_t> rows;
+        if (!Layout::ROW_MAJOR) {
+            gathered.resize(count);
+            rows.resize(count);
+            for (int y = 0; y < height; y++)
+                for (int x = 0; x < width; x++) gathered[size_t(y) * width + x] = cells[index(x, y)];
+        }
+        distances.resize(cells.size());
+        if (!fieldBackend->build(width, height, Layout::ROW_MAJOR ? cells.data() : gathered.data(),
+                                 targetPos, Layout::ROW_MAJOR ? distances.data() : rows.data())) {
+            return false;
+        }
+        if (!Layout::ROW_MAJOR) {
+            std::fill(distances.begin(), distances.end(), UNREACHABLE);
+            for (int y = 0; y < height; y++)
+                for (int x = 0; x < width; x++) distances[index(x, y)] = rows[size_t(y) * width + x];
+        }
+
+        fieldDirs.resize((cells.size() + 3) / 4);
+        maxDistance = 0;
+        for (int y = 1; y < height - 1; y++) {
+            for (int x = 1; x < width - 1; x++) {
+                size_t i = index(x, y);
+                uint32_t distance = distances[i];
+                if (distance == UNREACHABLE || distance == 0) continue;
+                maxDistance = std::max(maxDistance, distance);
+                for (int d = 0; d < 4; d++) {
+                    /* followField() steps against the stored direction */
+                    if (distances[neighborIndex(i, Vector2i(x, y), d ^ 1)] != distance - 1) continue;
+                    setPackedDir(fieldDirs, i, d);
+                    break;
+                }
+            }
+        }
+        fieldValid = true;
+        markAllChanged();
+        return true;
+    }
+
+    /* Step from `pos` in direction d and follow the corridor, calling
+     * visit(pos, index, direction) for every cell entered, until a node
+     * (a cell without exactly two open neighbours) or until visit returns
+     * true; returns the last cell entered */
+    template <typename Visit>
+    Vector2i walkCorridor(Vector2i pos, int d, Visit&& visit) const {
+        size_t i = index(pos.x, pos.y);
+        for (;;) {
+            i = neighborIndex(i, pos, d);
+            pos = Vector2i(pos.x + DIRECTIONS[d].x, pos.y + DIRECTIONS[d].y);
+            if (visit(pos, i, d)) return pos;
+            d = corridorTurn(i, pos, d);
+            if (d < 0) return pos;
+        }
+    }
+
+    /* Direction onwards from cell (i, pos), entered in direction d, or -1
+     * if it is a node.  DIRECTIONS pairs opposites as 2k, 2k + 1, and a
+     * corridor cell has exactly one open neighbour other than back. */
+    int corridorTurn(size_t i, Vector2i pos, int d) const {
+        unsigned ahead = 0;
+        for (int k = 0; k < 4; k++) ahead |= unsigned(typeAtIndex(neighborIndex(i, pos, k)) != WALL) << k;
+        ahead &= ~(1u << (d ^ 1));
+        if (!ahead || (ahead & (ahead - 1))) return -1;
+        static const int8_t lowestBit[16] = {0, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0};
+        return lowestBit[ahead];
+    }
+
+    /* Index of node n's edge leaving in direction d */
+    uint32_t edgeSlot(uint32_t n, int d) const {
+        const JunctionGraph::Node& node = graph.nodes[n];
+        uint32_t slot = graph.firstEdge[n];
+        for (int k = 0; k < d; k++) slot += typeAtIndex(neighborIndex(node.cell, node.pos, k)) != WALL;
+        return slot;
+    }
+
+    int openDegree(size_t i, Vector2i pos) const {
+        int degree = 0;
+        for (int d = 0; d < 4; d++) degree += typeAtIndex(neighborIndex(i, pos, d)) != WALL;
+        return degree;
+    }
+
+    /* stepCost() of the terrain at layout index i, under the player too */
+    uint32_t groundCost(size_t i) const {
+        CellType type = typeAtIndex(i);
+        return stepCost(type == PLAYER ? playerGround : type);
+    }
+
+    uint32_t heuristic(Vector2i pos, Vector2i to) const {
+        return minStepCost * (std::abs(pos.x - to.x) + std::abs(pos.y - to.y));
+    }
+
+    /* Write the unvisited cells two steps away and inside [lo, hi] into
+     * out[] and return how many there are; the caller picks one at random */
+    int getUnvisitedNeighbors(int x, int y, Vector2i lo, Vector2i hi,
+                              Vector2i out[4]) const {
+        int count = 0;
+        size_t i = index(x, y);
+        Vector2i pos(x, y);
+        auto unvisited = [&](int d) { return !(cells[neighborIndex(i, pos, d, 2)] & CELL_VISITED); };
+        if (x + 2 <= hi.x && unvisited(0)) out[count++] = Vector2i(x + 2, y);
+        if (x - 2 >= lo.x && unvisited(1)) out[count++] = Vector2i(x - 2, y);
+        if (y + 2 <= hi.y && unvisited(2)) out[count++] = Vector2i(x, y + 2);
+        if (y - 2 >= lo.y && unvisited(3)) out[count++] = Vector2i(x, y - 2);
+        return count;
+    }
+};
+
+typedef BasicMaze<MAZE_CELL_LAYOUT> Maze;
+
+#endif // MAZE_CORE_H
@@ -0,0 +1,453 @@
+/*
+ * Compact binary maze files.
+ *
+ * A file is a 68-byte header followed by the rooms of the maze (the cells
+ * at odd coordinates), 2 bits per room in row-major order: bit 0 set when
+ * the passage to the east is open, bit 1 when the passage to the south is.
+ * Four rooms share a byte, starting at the low bits; rows are not padded.
+ * All header fields are little-endian:
+ *
+ *   magic "MAZ2", then 32-bit format version, width, height (cells, odd),
+ *   seed, sequence (mazes generated from the seed before this one),
+ *   generator, threads; then 64-bit PCG state and increment after
+ *   generating this maze, and the loop and terrain fractions as IEEE
+ *   doubles; then 32-bit flags
+ *
+ * With MAZE_FILE_TERRAIN in the flags, a terrain plane packed the same way
+ * follows the rooms: three 2-bit slots per room, for the room, the passage
+ * east of it and the passage south of it, each 0 for plain ground, 1 for
+ * mud or 2 for ice.  Mazes without mud and ice leave it out.
+ *
+ * The RNG position and the braid and terrain settings let a loaded maze
+ * continue its seed's sequence without generating the mazes before it.
+ *
+ * A 2001x2001 maze takes 250 KB instead of the 4 MB of its cell grid.
+ * Files are memory mapped (read into memory on Windows), and PackedSolver
+ * runs BFS directly over the mapped rooms without unpacking them.
+ * packMaze() builds the same bytes in memory and packPath() writes a path
+ * as 2-bit steps; the C API and the server send both.
+ */
+
+#ifndef MAZE_FILE_H
+#define MAZE_FILE_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "maze_core.h"
+
+const char     MAZE_FILE_MAGIC[4]  = {'M', 'A', 'Z', '2'};
+const uint32_t MAZE_FILE_VERSION   = 3;
+const size_t   MAZE_FILE_HEADER_SIZE = 68;
+const uint32_t MAZE_FILE_TERRAIN   = 1; // flag: a terrain plane follows the rooms
+const uint32_t MAZE_FILE_MAX_THREADS = 1024; // sanity bound; Maze caps at hardwareThreads()
+
+enum RoomPassage : uint8_t {
+    ROOM_EAST  = 1,
+    ROOM_SOUTH = 2
+};
+
+/* A read-only view of a maze file held in memory */
+class PackedMaze {
+public:
+    /* Check the header and that the data holds every room */
+    bool open(const uint8_t* bytes, size_t size, std::string& error) {
+        if (size < MAZE_FILE_HEADER_SIZE || std::memcmp(bytes, MAZE_FILE_MAGIC, 4)) {
+            error = "not a maze file";
+            return false;
+        }
+        if (readU32(bytes + 4) != MAZE_FILE_VERSION) {
+            error = "unsupported maze file version";
+            return false;
+        }
+        uint32_t w = readU32(bytes + 8), h = readU32(bytes + 12);
+        if (w < 5 || h < 5 || w % 2 == 0 || h % 2 == 0 || w > 1u << 20 || h > 1u << 20) {
+            error = "bad maze dimensions";
+            return false;
+        }
+        uint32_t threads = readU32(bytes + 28);
+        if (threads == 0 || threads > MAZE_FILE_MAX_THREADS) {
+            error = "bad thread count";
+            return false;
+        }
+        double loops = readDouble(bytes + 48), terrainFraction = readDouble(bytes + 56);
+        if (!(loops >= 0 && loops <= 1) || !(terrainFraction >= 0 && terrainFraction <= 1)) {
+            error = "bad loop or terrain fraction";
+            return false;
+        }
+        width  = int(w);
+        height = int(h);
+        roomsWide = (width - 1) / 2;
+        roomsHigh = (height - 1) / 2;
+        size_t roomBytes = packedSize(roomsWide, roomsHigh);
+        bool withTerrain = readU32(bytes + 64) & MAZE_FILE_TERRAIN;
+        if (size - MAZE_FILE_HEADER_SIZE < roomBytes + (withTerrain ? terrainSize(roomsWide, roomsHigh) : 0)) {
+            error = "maze file is truncated";
+            return false;
+        }
+        header  = bytes;
+        rooms   = bytes + MAZE_FILE_HEADER_SIZE;
+        terrain = withTerrain ? rooms + roomBytes : nullptr;
+        return true;
+    }
+
+    int getWidth()  const { return width; }
+    int getHeight() const { return height; }
+    int getRoomsWide() const { return roomsWide; }
+    int getRoomsHigh() const { return roomsHigh; }
+    uint32_t getSeed()     const { return readU32(header + 16); }
+    uint32_t getSequence() const { return readU32(header + 20); }
+    GeneratorType getGenerator() const {
+        uint32_t type = readU32(header + 24);
+        return type < GENERATOR_COUNT ? GeneratorType(type) : BACKTRACKER;
+    }
+    int getThreads() const { return int(readU32(header + 28)); }
+    /* The RNG as generating this maze left it */
+    Pcg32 getRng() const {
+        Pcg32 rng;
+        rng.restore(readU64(header + 32), readU64(header + 40));
+        return rng;
+    }
+    double getLoopFraction()    const { return readDouble(header + 48); }
+    double getTerrainFraction() const { return readDouble(header + 56); }
+
+    /* ROOM_EAST / ROOM_SOUTH bits of room i (row-major) */
+    uint8_t passages(size_t i) const { return (rooms[i >> 2] >> ((i & 3) * 2)) & 3; }
+    bool eastOpen(int rx, int ry)  const { return passages(size_t(ry) * roomsWide + rx) & ROOM_EAST; }
+    bool southOpen(int rx, int ry) const { return passages(size_t(ry) * roomsWide + rx) & ROOM_SOUTH; }
+
+    bool hasTerrain() const { return terrain != nullptr; }
+    /* PATH, MUD or ICE: room (rx, ry) itself for slot 0, the passage east
+     * of it for 1, south for 2; PATH throughout without a terrain plane */
+    CellType ground(int rx, int ry, int slot) const {
+        if (!terrain) return PATH;
+        size_t i = 3 * (size_t(ry) * roomsWide + rx) + slot;
+        int code = (terrain[i >> 2] >> ((i & 3) * 2)) & 3;
+        return code == 1 ? MUD : code == 2 ? ICE : PATH;
+    }
+
+    static size_t packedSize(int roomsWide, int roomsHigh) {
+        return (size_t(roomsWide) * roomsHigh + 3) / 4;
+    }
+    static size_t terrainSize(int roomsWide, int roomsHigh) {
+        return (3 * size_t(roomsWide) * roomsHigh + 3) / 4;
+    }
+    static uint32_t readU32(const uint8_t* p) {
+        return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+    }
+    static uint64_t readU64(const uint8_t* p) { return readU32(p) | uint64_t(readU32(p + 4)) << 32; }
+    static double readDouble(const uint8_t* p) {
+        uint64_t bits = readU64(p);
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+private:
+    const uint8_t* header = nullptr;
+    const uint8_t* rooms  = nullptr;
+    const uint8_t* terrain = nullptr; // null without MAZE_FILE_TERRAIN
+    int width = 0, height = 0;
+    int roomsWide = 0, roomsHigh = 0;
+};
+
+/* A whole file mapped read-only into memory */
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    bool open(const char* path, std::string& error) {
+        close();
+#ifdef _WIN32
+        FILE* file = std::fopen(path, "rb");
+        if (!file) {
+            error = std::string("cannot open ") + path;
+            return false;
+        }
+        _fseeki64(file, 0, SEEK_END);
+        int64_t size = _ftelli64(file);  // ftell's long is 32-bit here
+        _fseeki64(file, 0, SEEK_SET);
+        buffer.resize(size > 0 ? size_t(size) : 0);
+        bool ok = size >= 0 && std::fread(buffer.data(), 1, buffer.size(), file) == buffer.size();
+        std::fclose(file);
+        if (!ok) {
+            error = std::string("cannot read ") + path;
+            buffer.clear();
+            return false;
+        }
+        bytes  = buffer.data();
+        length = buffer.size();
+#else
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            error = std::string("cannot open ") + path;
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) < 0 || info.st_size <= 0) {
+            ::close(fd);
+            error = std::string("cannot read ") + path;
+            return false;
+        }
+        void* mapping = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            error = std::string("cannot map ") + path;
+            return false;
+        }
+        bytes  = static_cast<const uint8_t*>(mapping);
+        length = size_t(info.st_size);
+#endif
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        buffer.clear();
+#else
+        if (bytes) munmap(const_cast<uint8_t*>(bytes), length);
+#endif
+        bytes  = nullptr;
+        length = 0;
+    }
+
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    std::vector<uint8_t> buffer;
+#endif
+};
+
+/* Produce the maze in the packed format one row of rooms at a time:
+ * write(bytes, count) receives the header, then the rooms, then the
+ * terrain plane if there is mud or ice, and returns false to stop */
+template <typename Write>
+bool writePackedMaze(const Maze& maze, Write&& write) {
+    int width = maze.getWidth(), height = maze.getHeight();
+    bool withTerrain = false;
+    for (int y = 1; y < height - 1 && !withTerrain; y++) {
+        for (int x = 1; x < width - 1 && !withTerrain; x++) {
+            CellType ground = maze.groundType(x, y);
+            withTerrain = ground == MUD || ground == ICE;
+        }
+    }
+
+    uint8_t header[MAZE_FILE_HEADER_SIZE];
+    uint32_t fields[7] = {MAZE_FILE_VERSION, uint32_t(maze.getWidth()), uint32_t(maze.getHeight()),
+                          maze.getSeed(), maze.getSequence(), uint32_t(maze.getGenerator()),
+                          uint32_t(maze.getThreads())};
+    uint64_t wideFields[4] = {maze.getRng().getState(), maze.getRng().getIncrement(), 0, 0};
+    double fractions[2] = {maze.getLoopFraction(), maze.getTerrainFraction()};
+    std::memcpy(&wideFields[2], fractions, sizeof(fractions));
+    std::memcpy(header, MAZE_FILE_MAGIC, 4);
+    for (int f = 0; f < 7; f++) {
+        for (int b = 0; b < 4; b++) header[4 + f * 4 + b] = uint8_t(fields[f] >> (b * 8));
+    }
+    for (int f = 0; f < 4; f++) {
+        for (int b = 0; b < 8; b++) header[32 + f * 8 + b] = uint8_t(wideFields[f] >> (b * 8));
+    }
+    uint32_t flags = withTerrain ? MAZE_FILE_TERRAIN : 0;
+    for (int b = 0; b < 4; b++) header[64 + b] = uint8_t(flags >> (b * 8));
+    bool ok = write(header, sizeof(header));
+
+    /* 2-bit slots are packed continuously across rows, so a byte may
+     * straddle two rows; `pending` carries the partial byte */
+    int roomsWide = (width - 1) / 2, roomsHigh = (height - 1) / 2;
+    std::vector<uint8_t> out;
+    out.reserve(3 * size_t(roomsWide) / 4 + 2);
+    uint8_t pending = 0;
+    size_t  slot = 0;
+    auto put = [&](int bits) {
+        pending |= uint8_t(bits << ((slot & 3) * 2));
+        if ((slot++ & 3) == 3) {
+            out.push_back(pending);
+            pending = 0;
+        }
+    };
+    auto finish = [&]() {
+        if (ok && (slot & 3)) ok = write(&pending, 1);
+        pending = 0;
+        slot = 0;
+    };
+    auto terrainCode = [&](int x, int y) {
+        CellType ground = maze.groundType(x, y);
+        return ground == MUD ? 1 : ground == ICE ? 2 : 0;
+    };
+
+    for (int ry = 0; ry < roomsHigh && ok; ry++) {
+        out.clear();
+        int y = 2 * ry + 1;
+        for (int rx = 0; rx < roomsWide; rx++) {
+            int x = 2 * rx + 1;
+            int bits = 0;
+            if (x + 1 < width - 1  && maze.cellType(x + 1, y) != WALL) bits |= ROOM_EAST;
+            if (y + 1 < height - 1 && maze.cellType(x, y + 1) != WALL) bits |= ROOM_SOUTH;
+            put(bits);
+        }
+        ok = write(out.data(), out.size());
+    }
+    finish();
+
+    for (int ry = 0; ry < roomsHigh && ok && withTerrain; ry++) {
+        out.clear();
+        int y = 2 * ry + 1;
+        for (int rx = 0; rx < roomsWide; rx++) {
+            int x = 2 * rx + 1;
+            put(terrainCode(x, y));
+            put(x + 1 < width - 1  ? terrainCode(x + 1, y) : 0);
+            put(y + 1 < height - 1 ? terrainCode(x, y + 1) : 0);
+        }
+        ok = write(out.data(), out.size());
+    }
+    finish();
+    return ok;
+}
+
+/* Write the maze to a file in the packed format */
+inline bool saveMaze(const Maze& maze, const char* path, std::string& error) {
+    FILE* file = std::fopen(path, "wb");
+    if (!file) {
+        error = std::string("cannot create ") + path;
+        return false;
+    }
+    bool ok = writePackedMaze(maze, [&](const uint8_t* bytes, size_t count) {
+        return std::fwrite(bytes, 1, count, file) == count;
+    });
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok) error = std::string("cannot write ") + path;
+    return ok;
+}
+
+/* The packed maze in memory, `out` reused */
+inline void packMaze(const Maze& maze, std::vector<uint8_t>& out) {
+    out.clear();
+    out.reserve(MAZE_FILE_HEADER_SIZE +
+                PackedMaze::packedSize((maze.getWidth() - 1) / 2, (maze.getHeight() - 1) / 2));
+    writePackedMaze(maze, [&](const uint8_t* bytes, size_t count) {
+        out.insert(out.end(), bytes, bytes + count);
+        return true;
+    });
+}
+
+/* A path packed as its steps: the DIRECTIONS index of every step from the
+ * start, 2 bits each, four to a byte from the low bits.  `path` is in the
+ * order of Maze::getPath() (target first, without the start). */
+inline void packPath(Vector2i from, const std::vector<Vector2i>& path, std::vector<uint8_t>& out) {
+    out.assign((path.size() + 3) / 4, 0);
+    Vector2i current = from;
+    for (size_t k = 0; k < path.size(); k++) {
+        Vector2i next = path[path.size() - 1 - k];
+        int d = next.x > current.x ? 0 : next.x < current.x ? 1 : next.y > current.y ? 2 : 3;
+        out[k >> 2] |= uint8_t(d << ((k & 3) * 2));
+        current = next;
+    }
+}
+
+/* Replace `maze` with the packed one, mud and ice included, taking over
+ * its generator, braid and terrain settings, seed, sequence and RNG
+ * position, so generating the next maze continues where the file's left
+ * off */
+inline void loadMaze(Maze& maze, const PackedMaze& packed) {
+    maze.setGenerator(packed.getGenerator());
+    maze.setThreads(packed.getThreads());
+    maze.setLoopFraction(packed.getLoopFraction());
+    maze.setTerrainFraction(packed.getTerrainFraction());
+    maze.setSeed(packed.getSeed());
+    maze.setSequence(packed.getSequence(), packed.getRng());
+    maze.loadRooms(packed.getWidth(), packed.getHeight(), [&](int rx, int ry, bool east) {
+        return east ? packed.eastOpen(rx, ry) : packed.southOpen(rx, ry);
+    }, [&](int rx, int ry, int slot) { return packed.ground(rx, ry, slot); });
+}
+
+/* BFS over the rooms of a PackedMaze.  The path is returned in cell
+ * coordinates like Maze::getPath(): target first, without the start,
+ * including the passage cells between rooms.  Scratch buffers are kept
+ * between solves. */
+class PackedSolver {
+public:
+    /* from and to must be rooms (odd coordinates); false if unreachable */
+    bool solve(const PackedMaze& maze, Vector2i from, Vector2i to) {
+        int roomsWide = maze.getRoomsWide(), roomsHigh = maze.getRoomsHigh();
+        size_t roomCount = size_t(roomsWide) * roomsHigh;
+        size_t start = size_t(from.y / 2) * roomsWide + from.x / 2;
+        size_t goal  = size_t(to.y / 2) * roomsWide + to.x / 2;
+
+        path.clear();
+        expanded = 0;
+        visited.assign((roomCount + 63) / 64, 0);
+        parents.resize((roomCount + 3) / 4);
+        queue.clear();
+        queue.push(start);
+        visited[start >> 6] |= uint64_t(1) << (start & 63);
+
+        /* Directions: 0 east, 1 west, 2 south, 3 north (as in Maze) */
+        while (!queue.empty()) {
+            size_t room = queue.front();
+            queue.pop();
+            expanded++;
+            if (room == goal) {
+                reconstruct(roomsWide, start, goal);
+                return true;
+            }
+            int rx = int(room % roomsWide), ry = int(room / roomsWide);
+            uint8_t here = maze.passages(room);
+            /* The bits come from the file, so passages out of the last
+             * column or row are ignored rather than trusted */
+            if (rx + 1 < roomsWide && (here & ROOM_EAST))            visit(room + 1, 0);
+            if (rx > 0 && (maze.passages(room - 1) & ROOM_EAST))     visit(room - 1, 1);
+            if (ry + 1 < roomsHigh && (here & ROOM_SOUTH))           visit(room + roomsWide, 2);
+            if (ry > 0 && (maze.passages(room - roomsWide) & ROOM_SOUTH)) visit(room - roomsWide, 3);
+        }
+        return false;
+    }
+
+    const std::vector<Vector2i>& getPath() const { return path; }
+    size_t cellsExpanded() const { return expanded; }
+
+private:
+    std::vector<uint64_t> visited;
+    std::vector<uint8_t>  parents;  // 2-bit direction each room was entered by
+    RingQueue<size_t>     queue;    // room indices; a file may hold over 2^32 rooms
+    std::vector<Vector2i> path;
+    size_t expanded = 0;
+
+    void visit(size_t room, int dir) {
+        uint64_t bit = uint64_t(1) << (room & 63);
+        if (visited[room >> 6] & bit) return;
+        visited[room >> 6] |= bit;
+        uint8_t& slot = parents[room >> 2];
+        int shift = int(room & 3) * 2;
+        slot = uint8_t((slot & ~(3 << shift)) | (dir << shift));
+        queue.push(room);
+    }
+
+    void reconstruct(int roomsWide, size_t start, size_t goal) {
+        static const int stepX[4] = {1, -1, 0, 0}, stepY[4] = {0, 0, 1, -1};
+        size_t room = goal;
+        while (room != start) {
+            int dir = (parents[room >> 2] >> ((room & 3) * 2)) & 3;
+            int x = 2 * int(room % roomsWide) + 1, y = 2 * int(room / roomsWide) + 1;
+            path.push_back(Vector2i(x, y));
+            path.push_back(Vector2i(x - stepX[dir], y - stepY[dir]));
+            /* Back against the step, in 64 bits: long is 32-bit on Windows */
+            room = size_t(int64_t(room) - stepX[dir] - int64_t(stepY[dir]) * roomsWide);
+        }
+    }
+};
+
+#endif // MAZE_FILE_H
@@ -0,0 +1,291 @@
+/*
+ * Distance field on the GPU.
+ *
+ * GpuDistanceField is a DistanceFieldBackend that runs the BFS from the
+ * target as a wavefront of fragment-shader passes: the maze is uploaded
+ * as a texture, two RGBA textures in a framebuffer object take turns as
+ * source and destination, and pass k marks every open cell next to a
+ * reached one with distance k.  Each cell holds distance + 1 in its four
+ * bytes (0 = not reached), so the shader never does arithmetic on
+ * distances, it only copies the value of the current ring from a uniform.
+ * An occlusion query every CHECK_PASSES passes counts the reached cells
+ * and stops the loop once it no longer grows; the result is read back
+ * into the maze's distances.
+ *
+ * Needs OpenGL 2.0 and EXT_framebuffer_object and a maze that fits in a
+ * texture; otherwise build() declines and the maze runs its CPU BFS.  The
+ * number of passes is the largest distance from the target, so the GPU
+ * wins on braided and open mazes and on hardware where a full-screen pass
+ * is cheap, and loses on perfect mazes with one very long corridor.
+ */
+
+#ifndef MAZE_GPU_H
+#define MAZE_GPU_H
+
+#include "maze_render.h"
+
+/* opengl32.lib only exports OpenGL 1.1 */
+#if !defined(_WIN32)
+#define MAZE_HAVE_GPU_FIELD 1
+#if defined(__APPLE__)
+#include <OpenGL/glext.h>
+#endif
+#endif
+
+#include <cstring>
+#include <vector>
+
+class GpuDistanceField : public DistanceFieldBackend {
+public:
+    /* Passes between two reads of the reached-cell count */
+    static const int CHECK_PASSES = 64;
+
+    /* Whether the current context can run the shader; the first call
+     * compiles it, so a context must be current */
+    bool available() {
+#ifdef MAZE_HAVE_GPU_FIELD
+        if (supported < 0) supported = setUp();
+        return supported == 1;
+#else
+        return false;
+#endif
+    }
+
+    bool build(int width, int height, const uint8_t* cells, Vector2i target,
+               uint32_t* distances) override {
+#ifdef MAZE_HAVE_GPU_FIELD
+        if (!available() || width > maxSize || height > maxSize) return false;
+        glPushAttrib(GL_VIEWPORT_BIT | GL_ENABLE_BIT | GL_TEXTURE_BIT | GL_COLOR_BUFFER_BIT);
+        glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+        GLint previousProgram = 0, previousFramebuffer = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING_EXT, &previousFramebuffer);
+        glMatrixMode(GL_PROJECTION);
+        glPushMatrix();
+        glLoadIdentity();
+        glMatrixMode(GL_MODELVIEW);
+        glPushMatrix();
+        glLoadIdentity();
+        glDisable(GL_BLEND);
+        glDisable(GL_DEPTH_TEST);
+
+        bool ok = runPasses(width, height, cells, target, distances);
+
+        glMatrixMode(GL_PROJECTION);
+        glPopMatrix();
+        glMatrixMode(GL_MODELVIEW);
+        glPopMatrix();
+        glUseProgram(previousProgram);
+        glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, previousFramebuffer);
+        glPopClientAttrib();
+        glPopAttrib();
+        return ok;
+#else
+        (void)width; (void)height; (void)cells; (void)target; (void)distances;
+        return false;
+#endif
+    }
+
+    /* Passes the last build() ran */
+    int getPasses() const { return passes; }
+
+    /* Free GL resources; must be called while the context is current */
+    void release() {
+#ifdef MAZE_HAVE_GPU_FIELD
+        if (program) glDeleteProgram(program);
+        if (framebuffer) glDeleteFramebuffersEXT(1, &framebuffer);
+        if (query) glDeleteQueries(1, &query);
+        if (fieldTextures[0]) glDeleteTextures(2, fieldTextures);
+        if (cellTexture) glDeleteTextures(1, &cellTexture);
+#endif
+        program = framebuffer = query = cellTexture = 0;
+        fieldTextures[0] = fieldTextures[1] = 0;
+        textureWidth = textureHeight = 0;
+        supported = -1;
+    }
+
+private:
+    int    supported = -1; // -1 until checked
+    GLint  maxSize = 0;
+    GLuint program = 0;
+    GLuint framebuffer = 0;
+    GLuint query = 0;
+    GLuint fieldTextures[2] = {0, 0};
+    GLuint cellTexture = 0;
+    int    textureWidth  = 0;
+    int    textureHeight = 0;
+    int    passes = 0;
+    GLint  fieldUniform = -1, cellsUniform = -1, texelUniform = -1, ringUniform = -1;
+    std::vector<uint8_t> pixels;
+
+#ifdef MAZE_HAVE_GPU_FIELD
+    /* A cell already reached keeps its value; an open one next to a
+     * reached one takes the ring's; everything else is discarded, so the
+     * query counts reached cells and unreached ones stay 0 in both
+     * textures */
+    static const char* shaderSource() {
+        return
+            "uniform sampler2D field;\n"
+            "uniform sampler2D cells;\n"
+            "uniform vec2 texel;\n"
+            "uniform vec4 ring;\n"
+            "void main() {\n"
+            "    vec2 p = gl_TexCoord[0].xy;\n"
+            "    vec4 here = texture2D(field, p);\n"
+            "    if (here != vec4(0.0)) { gl_FragColor = here; return; }\n"
+            "    if (texture2D(cells, p).r == 0.0) discard;\n"
+            "    vec4 near = texture2D(field, p + vec2(texel.x, 0.0)) +\n"
+            "                texture2D(field, p - vec2(texel.x, 0.0)) +\n"
+            "                texture2D(field, p + vec2(0.0, texel.y)) +\n"
+            "                texture2D(field, p - vec2(0.0, texel.y));\n"
+            "    if (near == vec4(0.0)) discard;\n"
+            "    gl_FragColor = ring;\n"
+            "}\n";
+    }
+
+    bool setUp() {
+        int major = 1, minor = 0;
+        const char* version    = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+        const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+        if (version) std::sscanf(version, "%d.%d", &major, &minor);
+        if (major < 2 || !extensions || !std::strstr(extensions, "GL_EXT_framebuffer_object")) return false;
+
+        GLuint shader = glCreateShader(GL_FRAGMENT_SHADER);
+        const char* source = shaderSource();
+        glShaderSource(shader, 1, &source, nullptr);
+        glCompileShader(shader);
+        GLint compiled = 0;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+        if (!compiled) {
+            glDeleteShader(shader);
+            return false;
+        }
+        program = glCreateProgram();
+        glAttachShader(program, shader);
+        glLinkProgram(program);
+        glDeleteShader(shader);
+        GLint linked = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked) return false;
+        fieldUniform = glGetUniformLocation(program, "field");
+        cellsUniform = glGetUniformLocation(program, "cells");
+        texelUniform = glGetUniformLocation(program, "texel");
+        ringUniform  = glGetUniformLocation(program, "ring");
+
+        GLint viewport[2] = {0, 0};
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+        glGetIntegerv(GL_MAX_VIEWPORT_DIMS, viewport);
+        maxSize = std::min(maxSize, std::min(viewport[0], viewport[1]));
+        glGenFramebuffersEXT(1, &framebuffer);
+        glGenQueries(1, &query);
+        return true;
+    }
+
+    static void setNearest() {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+
+    /* (Re)allocate the textures for a width x height maze (NPOT sizes are
+     * core in OpenGL 2.0) */
+    void resize(int width, int height) {
+        if (width == textureWidth && height == textureHeight) return;
+        if (!fieldTextures[0]) glGenTextures(2, fieldTextures);
+        if (!cellTexture) glGenTextures(1, &cellTexture);
+        for (GLuint texture : fieldTextures) {
+            glBindTexture(GL_TEXTURE_2D, texture);
+            setNearest();
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+        glBindTexture(GL_TEXTURE_2D, cellTexture);
+        setNearest();
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE8, width, height, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, nullptr);
+        textureWidth  = width;
+        textureHeight = height;
+    }
+
+    static void encode(uint32_t value, uint8_t out[4]) {
+        for (int b = 0; b < 4; b++) out[b] = uint8_t(value >> (8 * b));
+    }
+
+    bool attach(GLuint texture) {
+        glFramebufferTexture2DEXT(GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, texture, 0);
+        return glCheckFramebufferStatusEXT(GL_FRAMEBUFFER_EXT) == GL_FRAMEBUFFER_COMPLETE_EXT;
+    }
+
+    bool runPasses(int width, int height, const uint8_t* cells, Vector2i target, uint32_t* distances) {
+        while (glGetError() != GL_NO_ERROR) {} // report only our own errors below
+        resize(width, height);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glBindTexture(GL_TEXTURE_2D, cellTexture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_LUMINANCE, GL_UNSIGNED_BYTE, cells);
+
+        /* Both field textures start empty; the target is distance 0 */
+        glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, framebuffer);
+        glClearColor(0, 0, 0, 0);
+        for (GLuint texture : fieldTextures) {
+            if (!attach(texture)) {
+                supported = 0;
+                return false;
+            }
+            glClear(GL_COLOR_BUFFER_BIT);
+        }
+        uint8_t seed[4];
+        encode(1, seed);
+        glBindTexture(GL_TEXTURE_2D, fieldTextures[0]);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, target.x, target.y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, seed);
+
+        glViewport(0, 0, width, height);
+        glUseProgram(program);
+        glUniform1i(fieldUniform, 0);
+        glUniform1i(cellsUniform, 1);
+        glUniform2f(texelUniform, 1.0f / width, 1.0f / height);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, cellTexture);
+        glActiveTexture(GL_TEXTURE0);
+
+        GLuint reached = 1;
+        int pass = 0;
+        const int maxPasses = width * height; // no distance is larger
+        while (pass < maxPasses) {
+            pass++;
+            glBindTexture(GL_TEXTURE_2D, fieldTextures[(pass - 1) & 1]);
+            attach(fieldTextures[pass & 1]);
+            uint8_t ring[4];
+            encode(uint32_t(pass) + 1, ring);
+            glUniform4f(ringUniform, ring[0] / 255.0f, ring[1] / 255.0f, ring[2] / 255.0f, ring[3] / 255.0f);
+
+            bool check = pass % CHECK_PASSES == 0;
+            if (check) glBeginQuery(GL_SAMPLES_PASSED, query);
+            glBegin(GL_QUADS);
+            glTexCoord2f(0, 0); glVertex2f(-1, -1);
+            glTexCoord2f(1, 0); glVertex2f( 1, -1);
+            glTexCoord2f(1, 1); glVertex2f( 1,  1);
+            glTexCoord2f(0, 1); glVertex2f(-1,  1);
+            glEnd();
+            if (check) {
+                glEndQuery(GL_SAMPLES_PASSED);
+                GLuint count = 0;
+                glGetQueryObjectuiv(query, GL_QUERY_RESULT, &count);
+                if (count == reached) break;
+                reached = count;
+            }
+        }
+        passes = pass;
+
+        pixels.resize(size_t(width) * height * 4);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        for (size_t i = 0, n = size_t(width) * height; i < n; i++) {
+            const uint8_t* p = &pixels[i * 4];
+            uint32_t value = p[0] | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+            distances[i] = value ? value - 1 : UNREACHABLE;
+        }
+        return glGetError() == GL_NO_ERROR;
+    }
+#endif
+};
+
+#endif // MAZE_GPU_H
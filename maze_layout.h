@@ -0,0 +1,100 @@
+/*
+ * Cell layouts: where cell (x, y) of a width x height grid lives in the
+ * cell array.  BasicMaze takes one as a template parameter and sends every
+ * cell access through index(), so the layout is chosen at build time.
+ *
+ *  RowMajorLayout  y * width + x: rows are contiguous and the vertical
+ *                  neighbours of a cell are a whole row apart
+ *  TiledLayout<T>  T x T tiles stored one after another (row-major inside
+ *                  and between tiles); at T = 8 a tile of byte cells is one
+ *                  64-byte cache line
+ *  MortonLayout    64 x 64 blocks (4 KB, one page of byte cells) in
+ *                  row-major order, Z-order inside each block, so nearby
+ *                  cells share lines and pages in both directions
+ *
+ * Rows are only contiguous in RowMajorLayout (ROW_MAJOR); the others pad
+ * the grid to whole tiles or blocks, so size() may exceed width * height.
+ */
+
+#ifndef MAZE_LAYOUT_H
+#define MAZE_LAYOUT_H
+
+#include <cstddef>
+#include <cstdint>
+
+struct RowMajorLayout {
+    static const bool ROW_MAJOR = true;
+    static const char* name() { return "row-major"; }
+
+    void resize(int w, int h) {
+        width  = static_cast<size_t>(w);
+        height = static_cast<size_t>(h);
+    }
+    size_t size() const { return width * height; }
+    size_t index(int x, int y) const { return static_cast<size_t>(y) * width + x; }
+
+private:
+    size_t width = 0, height = 0;
+};
+
+template <int T>
+struct TiledLayout {
+    static_assert(T > 0 && (T & (T - 1)) == 0, "tile size must be a power of two");
+    static const bool ROW_MAJOR = false;
+    static const char* name() { return "tiled"; }
+
+    void resize(int w, int h) {
+        tilesX = (static_cast<size_t>(w) + T - 1) / T;
+        tilesY = (static_cast<size_t>(h) + T - 1) / T;
+    }
+    size_t size() const { return tilesX * tilesY * T * T; }
+    size_t index(int x, int y) const {
+        size_t tile = (static_cast<size_t>(y) / T) * tilesX + static_cast<size_t>(x) / T;
+        return tile * (T * T) + (y & (T - 1)) * T + (x & (T - 1));
+    }
+
+private:
+    size_t tilesX = 0, tilesY = 0;
+};
+
+struct MortonLayout {
+    static const bool ROW_MAJOR = false;
+    static const char* name() { return "morton"; }
+
+    void resize(int w, int h) {
+        blocksX = (static_cast<size_t>(w) + 63) >> 6;
+        blocksY = (static_cast<size_t>(h) + 63) >> 6;
+    }
+    size_t size() const { return blocksX * blocksY << 12; }
+    size_t index(int x, int y) const {
+        size_t block = (static_cast<size_t>(y) >> 6) * blocksX + (static_cast<size_t>(x) >> 6);
+        return block << 12 | spread(x & 63) | spread(y & 63) << 1;
+    }
+
+private:
+    size_t blocksX = 0, blocksY = 0;
+
+    /* Bits 0..5 of v moved to the even bits 0..10 */
+    static size_t spread(int v) {
+        static const uint16_t table[64] = {
+#define MAZE_SPREAD(v) uint16_t(((v) & 1) | ((v) & 2) << 1 | ((v) & 4) << 2 | ((v) & 8) << 3 | \
+                                ((v) & 16) << 4 | ((v) & 32) << 5)
+#define MAZE_SPREAD4(v) MAZE_SPREAD(v), MAZE_SPREAD(v + 1), MAZE_SPREAD(v + 2), MAZE_SPREAD(v + 3)
+            MAZE_SPREAD4(0),  MAZE_SPREAD4(4),  MAZE_SPREAD4(8),  MAZE_SPREAD4(12),
+            MAZE_SPREAD4(16), MAZE_SPREAD4(20), MAZE_SPREAD4(24), MAZE_SPREAD4(28),
+            MAZE_SPREAD4(32), MAZE_SPREAD4(36), MAZE_SPREAD4(40), MAZE_SPREAD4(44),
+            MAZE_SPREAD4(48), MAZE_SPREAD4(52), MAZE_SPREAD4(56), MAZE_SPREAD4(60)
+#undef MAZE_SPREAD4
+#undef MAZE_SPREAD
+        };
+        return table[v];
+    }
+};
+
+/* Layout of the Maze type used by the app and the other headers;
+ * build with e.g. -DMAZE_CELL_LAYOUT=MortonLayout to switch */
+#ifndef MAZE_CELL_LAYOUT
+#define MAZE_CELL_LAYOUT RowMajorLayout
+#endif
+
+#endif // MAZE_LAYOUT_H
@@ -0,0 +1,236 @@
+/*
+ * Multi-level mazes.  LevelMaze is a standalone 3D maze: a back-tracker
+ * carves it and BFS solves it over x, y and z, with up and down added to
+ * the four DIRECTIONS as directions 4 and 5.  Every z plane is stored in
+ * the cell layout Maze uses, one plane after another.
+ *
+ * As in the plane, rooms sit at odd coordinates on every axis and the
+ * cells between them are walls or passages, so the levels a player walks
+ * on are the odd z planes and an open cell of an even plane is a stairwell
+ * between the levels below and above.  The outer shell stays solid, so the
+ * search loops need no bounds checks.  Cells are one byte each and the
+ * solver keeps its state in a LevelScratch, so a solve on a maze of
+ * unchanged size performs no allocations.
+ *
+ * It supports only the back-tracker and BFS; the other generators and
+ * solvers, braiding, terrain and files are Maze's, in the plane.
+ * showLevel() copies one level into a Maze for MazeRenderer to draw.
+ */
+
+#ifndef MAZE_LEVELS_H
+#define MAZE_LEVELS_H
+
+#include "maze_core.h"
+
+struct Vector3i {
+    int x, y, z;
+    constexpr Vector3i(int x = 0, int y = 0, int z = 0) : x(x), y(y), z(z) {}
+    bool operator==(const Vector3i& other) const {
+        return x == other.x && y == other.y && z == other.z;
+    }
+};
+
+/* DIRECTIONS, then up and down: d and d ^ 1 are opposite */
+constexpr Vector3i DIRECTIONS_3D[6] = {Vector3i(1, 0, 0), Vector3i(-1, 0, 0), Vector3i(0, 1, 0),
+                                       Vector3i(0, -1, 0), Vector3i(0, 0, 1), Vector3i(0, 0, -1)};
+
+/* Working memory of LevelMaze::solve(); like SolverScratch, buffers only
+ * grow and each thread needs its own */
+struct LevelScratch {
+    std::vector<uint8_t> parents; // 0 = not reached, else 1 + the arrival direction
+    RingQueue<Vector3i> queue;
+
+    void prepare(size_t cellCount) {
+        parents.assign(cellCount, 0);
+        queue.clear();
+    }
+};
+
+class LevelMaze {
+public:
+    /* Width and height are rounded up to odd values (minimum 5) like
+     * Maze's, the depth to an odd number of planes (minimum 3) */
+    explicit LevelMaze(Vector3i size, uint32_t seed = static_cast<uint32_t>(std::time(nullptr))) {
+        extents = Vector3i(Maze::normalizeSize(size.x), Maze::normalizeSize(size.y),
+                           std::max(3, size.z) | 1);
+        layout.resize(extents.x, extents.y);
+        planeCells = layout.size();
+        for (int d = 0; d < 4; d++) offsets[d] = ptrdiff_t(DIRECTIONS[d].y) * extents.x + DIRECTIONS[d].x;
+        offsets[4] = ptrdiff_t(planeCells);
+        offsets[5] = -ptrdiff_t(planeCells);
+        cells.resize(planeCells * extents.z);
+        setSeed(seed);
+        generate();
+    }
+
+    void setSeed(uint32_t value) {
+        seed = value;
+        rng.seed(value);
+        generated = 0;
+    }
+
+    /* Iterative back-tracking from the first room, with the stack reserved
+     * up front and the neighbours gathered into a fixed array */
+    void generate() {
+        ScopedTimer timer(STAT_GENERATE);
+        std::fill(cells.begin(), cells.end(), static_cast<uint8_t>(WALL));
+        stack.reserve(size_t(extents.x / 2) * (extents.y / 2) * (extents.z / 2));
+
+        uint8_t* cell = cells.data();
+        Vector3i start = getStart();
+        cell[index(start)] = PATH | CELL_VISITED;
+        stack.clear();
+        stack.push_back(start);
+
+        int directions[6];
+        while (!stack.empty()) {
+            Vector3i current = stack.back();
+            size_t here = index(current);
+
+            int count = 0;
+            for (int d = 0; d < 6; d++) {
+                if (inside(current, d) && !(cell[neighbor(here, current, d, 2)] & CELL_VISITED)) {
+                    directions[count++] = d;
+                }
+            }
+
+            if (count > 0) {
+                int d = directions[count > 1 ? rng.below(count) : 0];
+                cell[neighbor(here, current, d)] = PATH;
+                cell[neighbor(here, current, d, 2)] = PATH | CELL_VISITED;
+                stack.push_back(step(current, d, 2));
+            } else {
+                stack.pop_back();
+            }
+        }
+        for (auto& c : cells) c &= CELL_TYPE_MASK;
+        generated++;
+    }
+
+    /* Breadth-First Search from `from` to `to`.  The path is written target
+     * first and without `from`, like Maze::getPath(). */
+    bool solve(Vector3i from, Vector3i to, LevelScratch& scratch, std::vector<Vector3i>& path,
+               SolveStats& stats) const {
+        ScopedTimer timer(STAT_SOLVE);
+        auto start = std::chrono::steady_clock::now();
+        path.clear();
+        stats.solver = SOLVER_BFS;
+        stats.cellsExpanded = 0;
+        bool found = isOpen(from) && isOpen(to) && search(from, to, scratch, path, stats);
+        stats.queuePeak = scratch.queue.peak();
+        stats.pathCost = path.size() * stepCost(PATH);
+        stats.microseconds = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count();
+        return found;
+    }
+
+    /* The first and the last room, where the player starts and the target sits */
+    Vector3i getStart() const { return Vector3i(1, 1, 1); }
+    Vector3i getTarget() const { return Vector3i(extents.x - 2, extents.y - 2, extents.z - 2); }
+
+    Vector3i getSize() const { return extents; }
+    size_t cellCount() const { return cells.size(); }
+    uint32_t getSeed() const { return seed; }
+    uint32_t getGenerated() const { return generated; }
+    CellType cellType(Vector3i p) const { return static_cast<CellType>(cells[index(p)] & CELL_TYPE_MASK); }
+    bool isOpen(Vector3i p) const {
+        return p.x >= 0 && p.x < extents.x && p.y >= 0 && p.y < extents.y && p.z >= 0 &&
+               p.z < extents.z && cellType(p) != WALL;
+    }
+
+private:
+    Vector3i extents;
+    MAZE_CELL_LAYOUT layout;   // of each z plane
+    size_t planeCells = 0;
+    ptrdiff_t offsets[6] = {}; // index steps of DIRECTIONS_3D in the row-major layout
+    std::vector<uint8_t> cells; // one byte per cell, plane after plane
+    std::vector<Vector3i> stack; // back-tracking stack, kept to reuse its storage
+    Pcg32 rng;
+    uint32_t seed = 0;
+    uint32_t generated = 0;
+
+    size_t index(Vector3i p) const { return size_t(p.z) * planeCells + layout.index(p.x, p.y); }
+    static Vector3i step(Vector3i p, int d, int n = 1) {
+        return Vector3i(p.x + n * DIRECTIONS_3D[d].x, p.y + n * DIRECTIONS_3D[d].y,
+                        p.z + n * DIRECTIONS_3D[d].z);
+    }
+    /* Up and down are a whole plane apart in every layout */
+    size_t neighbor(size_t i, Vector3i p, int d, int n = 1) const {
+        if (MAZE_CELL_LAYOUT::ROW_MAJOR || d >= 4) return i + n * offsets[d];
+        return index(step(p, d, n));
+    }
+    /* Whether the room two steps from p towards d is inside the wall shell */
+    bool inside(Vector3i p, int d) const {
+        switch (d) {
+            case 0:  return p.x + 2 <= extents.x - 2;
+            case 1:  return p.x - 2 >= 1;
+            case 2:  return p.y + 2 <= extents.y - 2;
+            case 3:  return p.y - 2 >= 1;
+            case 4:  return p.z + 2 <= extents.z - 2;
+            default: return p.z - 2 >= 1;
+        }
+    }
+
+    bool search(Vector3i from, Vector3i to, LevelScratch& scratch, std::vector<Vector3i>& path,
+                SolveStats& stats) const {
+        scratch.prepare(cells.size());
+        const uint8_t* cell = cells.data();
+        uint8_t* parents = scratch.parents.data();
+        scratch.queue.push(from);
+        parents[index(from)] = 1;
+
+        while (!scratch.queue.empty()) {
+            Vector3i current = scratch.queue.front();
+            scratch.queue.pop();
+            stats.cellsExpanded++;
+
+            if (current == to) {
+                ScopedTimer reconstruct(STAT_RECONSTRUCT);
+                for (Vector3i p = to; !(p == from);) {
+                    path.push_back(p);
+                    p = step(p, parents[index(p)] - 1, -1);
+                }
+                return true;
+            }
+
+            size_t here = index(current);
+            for (int d = 0; d < 6; d++) {
+                size_t i = neighbor(here, current, d);
+                if (parents[i] || (cell[i] & CELL_TYPE_MASK) == WALL) continue;
+                parents[i] = static_cast<uint8_t>(d + 1);
+                scratch.queue.push(step(current, d));
+            }
+        }
+        return false;
+    }
+};
+
+/* Level count of a LevelMaze and the z plane of level k (from 0) */
+inline int levelCount(const LevelMaze& maze) { return maze.getSize().z / 2; }
+inline int levelPlane(int level) { return 2 * level + 1; }
+
+/* Draw level `level` of `maze` into `view`: stairwell rooms become
+ * STAIRS_UP, STAIRS_DOWN or STAIRS, the start and target PLAYER and
+ * TARGET, and the cells of `path` on this level the shown path */
+template <typename Layout>
+void showLevel(const LevelMaze& maze, int level, const std::vector<Vector3i>& path,
+               BasicMaze<Layout>& view) {
+    int z = levelPlane(level);
+    Vector3i size = maze.getSize(), start = maze.getStart(), target = maze.getTarget();
+    std::vector<Vector2i> shown;
+    for (const Vector3i& p : path) {
+        if (p.z == z) shown.push_back(Vector2i(p.x, p.y));
+    }
+    view.loadCells(size.x, size.y, [&](int x, int y) {
+        Vector3i p(x, y, z);
+        if (p == start) return PLAYER;
+        if (p == target) return TARGET;
+        CellType type = maze.cellType(p);
+        if (type == WALL) return WALL;
+        bool up = maze.cellType(Vector3i(x, y, z + 1)) != WALL;
+        bool down = maze.cellType(Vector3i(x, y, z - 1)) != WALL;
+        return up && down ? STAIRS : up ? STAIRS_UP : down ? STAIRS_DOWN : type;
+    }, shown);
+}
+
+#endif // MAZE_LEVELS_H
@@ -0,0 +1,102 @@
+/*
+ * Background maze generation.
+ *
+ * MazePrefetcher keeps the next few mazes of a Maze's sequence ready on a
+ * worker thread; each one is a complete Maze (generated, reset, distance
+ * field built if enabled).  takeNext() moves a ready one into the shown
+ * maze, so a new maze replaces the old one in the time of a move
+ * assignment and the caller's thread never generates.  Because the worker
+ * continues from the shown maze's recipe (including its RNG state), the
+ * mazes are exactly the ones generateNewMaze() would have produced.
+ */
+
+#ifndef MAZE_PREFETCH_H
+#define MAZE_PREFETCH_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "maze_core.h"
+
+class MazePrefetcher {
+public:
+    /* Keep up to `depth` mazes ready; the worker starts with the first
+     * restart() */
+    explicit MazePrefetcher(size_t depth = 1) : depth(std::max<size_t>(1, depth)) {}
+    MazePrefetcher(const MazePrefetcher&) = delete;
+    MazePrefetcher& operator=(const MazePrefetcher&) = delete;
+
+    ~MazePrefetcher() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        if (worker.joinable()) worker.join();
+    }
+
+    /* Drop the ready mazes and prefetch the ones that follow `maze`; call
+     * after changing any of its generator settings */
+    void restart(const Maze& maze) {
+        std::deque<Maze> stale;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            next = maze.recipe();
+            hasRecipe = true;
+            epoch++;
+            stale.swap(ready);
+        }
+        if (!worker.joinable()) worker = std::thread([this]() { run(); });
+        wake.notify_all();
+    }
+
+    /* Move the next ready maze into `maze`; false if none is ready yet */
+    bool takeNext(Maze& maze) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (ready.empty()) return false;
+            maze = std::move(ready.front());
+            ready.pop_front();
+        }
+        wake.notify_all();
+        return true;
+    }
+
+    size_t readyCount() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return ready.size();
+    }
+
+private:
+    size_t depth;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Maze> ready;
+    MazeRecipe next;           // recipe of the maze after the last ready one
+    bool     hasRecipe = false;
+    uint64_t epoch     = 0;    // bumped by restart()
+    bool     stopping  = false;
+    std::thread worker;
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [this]() { return stopping || (hasRecipe && ready.size() < depth); });
+            if (stopping) return;
+            MazeRecipe recipe = next;
+            uint64_t started = epoch;
+
+            lock.unlock();
+            Maze maze(recipe);
+            lock.lock();
+
+            if (epoch != started) continue; // restarted meanwhile
+            next = maze.recipe();
+            ready.push_back(std::move(maze));
+        }
+    }
+};
+
+#endif // MAZE_PREFETCH_H
@@ -0,0 +1,811 @@
+/*
+ * OpenGL 1.x renderer for Maze.
+ *
+ * Three modes are available:
+ *  - immediate: the original glBegin/glEnd per cell;
+ *  - batched: every cell quad in one vertex array drawn with a single
+ *    glDrawArrays, kept in a buffer object when the driver offers OpenGL
+ *    1.5 and in client memory otherwise;
+ *  - texture: one texel per cell drawn as a single nearest-filtered quad.
+ * The batched and texture modes follow Maze's change log, so after the
+ * first frame a move only re-uploads the two cells it touched.
+ *
+ * A camera (pan and zoom over a window of fixed size) picks the part of
+ * the maze on screen; only visible cells are drawn.  When a cell shrinks
+ * below a pixel, every mode switches to a mip-style level of detail that
+ * averages 2^k x 2^k blocks, so frame cost follows the window size
+ * instead of the maze size.
+ */
+
+#ifndef MAZE_RENDER_H
+#define MAZE_RENDER_H
+
+#if defined(__APPLE__)
+#include <OpenGL/gl.h>
+#define MAZE_HAVE_BUFFER_OBJECTS 1
+#elif defined(_WIN32)
+#include <windows.h>
+#include <GL/gl.h>
+/* opengl32.lib only exports OpenGL 1.1; batched mode uses client arrays */
+#else
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#define MAZE_HAVE_BUFFER_OBJECTS 1
+#endif
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "maze_core.h"
+
+const int MAX_CELL_SIZE = 50;
+
+/* Beyond this many cells the batched arrays get too large and the
+ * renderer falls back to immediate mode */
+const size_t MAX_BATCHED_CELLS = 4 * 1024 * 1024;
+
+/* Closest camera zoom: pixels per cellSize unit */
+const float MAX_ZOOM = 4.0f;
+
+struct Color {
+    float r, g, b;
+    Color(float r, float g, float b) : r(r), g(g), b(b) {}
+};
+
+enum RenderMode {
+    RENDER_IMMEDIATE,
+    RENDER_BATCHED,
+    RENDER_TEXTURE,
+    RENDER_MODE_COUNT
+};
+
+inline const char* renderModeName(RenderMode mode) {
+    switch (mode) {
+        case RENDER_IMMEDIATE: return "immediate";
+        case RENDER_BATCHED:   return "batched";
+        case RENDER_TEXTURE:   return "texture";
+        default:               return "unknown";
+    }
+}
+
+inline bool parseRenderModeName(const char* name, RenderMode& mode) {
+    for (int i = 0; i < RENDER_MODE_COUNT; i++) {
+        if (!std::strcmp(name, renderModeName(RenderMode(i)))) {
+            mode = RenderMode(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+/* All OpenGL drawing lives here; Maze itself never touches GL, so the
+ * generator and solvers can also run without a window (see --headless). */
+class MazeRenderer {
+public:
+    /* Size of one cell in maze coordinates; on screen it is scaled by the
+     * camera zoom */
+    void setCellSize(float size) {
+        cellSize = size;
+        geometryCells = 0;
+    }
+
+    RenderMode getMode() const { return mode; }
+    void setMode(RenderMode renderMode) { mode = renderMode; }
+
+    /* Camera.  Until a viewport is set the caller's projection is used
+     * and the whole maze counts as visible. */
+    void setViewport(int width, int height) {
+        viewportWidth  = std::max(1, width);
+        viewportHeight = std::max(1, height);
+    }
+    /* Centre the maze and zoom so all of it fits the viewport */
+    void fitMaze(const Maze& maze) {
+        float mazeWidth = maze.getWidth() * cellSize, mazeHeight = maze.getHeight() * cellSize;
+        viewX = mazeWidth / 2;
+        viewY = mazeHeight / 2;
+        fitZoom = std::min(viewportWidth / mazeWidth, viewportHeight / mazeHeight);
+        zoom = fitZoom;
+    }
+    /* Move the view by a mouse drag of (dx, dy) pixels */
+    void pan(float dx, float dy) {
+        viewX -= dx / zoom;
+        viewY -= dy / zoom;
+    }
+    /* Zoom by factor keeping the maze point under pixel (px, py) in place */
+    void zoomAt(float factor, float px, float py) {
+        float offsetX = px - viewportWidth / 2.0f, offsetY = py - viewportHeight / 2.0f;
+        float worldX = viewX + offsetX / zoom, worldY = viewY + offsetY / zoom;
+        zoom = std::max(fitZoom / 4, std::min(MAX_ZOOM, zoom * factor));
+        viewX = worldX - offsetX / zoom;
+        viewY = worldY - offsetY / zoom;
+    }
+    float getZoom() const { return zoom; }
+
+    /* Free GL resources; must be called while the context is current */
+    void release() {
+#ifdef MAZE_HAVE_BUFFER_OBJECTS
+        if (buffer) glDeleteBuffers(1, &buffer);
+#endif
+        if (texture) glDeleteTextures(1, &texture);
+        if (levelTexture) glDeleteTextures(1, &levelTexture);
+        if (pathTexture) glDeleteTextures(1, &pathTexture);
+        buffer = 0;
+        texture = 0;
+        levelTexture = 0;
+        pathTexture = 0;
+        pathTextureWidth = pathTextureHeight = pathTextureLevel = 0;
+        geometryCells = 0;
+        textureWidth = textureHeight = 0;
+        levelTextureWidth = levelTextureHeight = levelTextureShown = 0;
+        textureSync = SyncState();
+    }
+
+    /* Render the visible part of the maze, falling back to a simpler mode
+     * when the maze is too large for the selected one */
+    void draw(const Maze& maze) {
+        ScopedTimer timer(STAT_DRAW);
+        glClear(GL_COLOR_BUFFER_BIT);
+        applyCamera();
+
+        CellRect view = visibleCells(maze);
+        int level = detailLevel();
+        size_t cellCount = size_t(maze.getWidth()) * maze.getHeight();
+        bool immediate = false;
+        if (level > 0) {
+            drawLevelOfDetail(maze, view, level);
+        } else if (mode == RENDER_TEXTURE && textureFits(maze.getWidth(), maze.getHeight())) {
+            drawTextured(maze);
+        } else if (mode != RENDER_IMMEDIATE && cellCount <= MAX_BATCHED_CELLS) {
+            drawBatched(maze, view);
+        } else {
+            drawImmediate(maze, view);
+            immediate = true;
+        }
+
+        if (level == 0) drawCellGaps(view);
+        if (immediate) drawImmediatePath(maze, view);
+        else           drawPathOverlay(maze, view, level);
+    }
+
+private:
+    float cellSize = MAX_CELL_SIZE;
+    RenderMode mode = RENDER_BATCHED;
+
+    /* Camera: viewport in pixels, view centre in maze coordinates (cellSize
+     * units per cell) and zoom in pixels per unit */
+    int   viewportWidth  = 0;
+    int   viewportHeight = 0;
+    float viewX   = 0;
+    float viewY   = 0;
+    float zoom    = 1.0f;
+    float fitZoom = 1.0f;
+
+    /* Half-open range of cells [x0, x1) x [y0, y1) */
+    struct CellRect {
+        int x0, y0, x1, y1;
+    };
+
+    /* Batched mode: 4 vertices per cell, positions fixed for a given maze
+     * size and cell size, colours updated from the change log */
+    std::vector<float>   vertices;
+    std::vector<uint8_t> colors;
+    std::vector<float>   pathVertices;
+    std::vector<float>   gapVertices;
+    std::vector<uint8_t> pathBlocks; // detail-level blocks already on the path overlay
+    size_t geometryCells  = 0;  // cell count the vertex arrays were built for
+    int    geometryWidth  = 0;
+    GLuint buffer = 0;
+    int    bufferObjects  = -1; // -1 until the GL version has been checked
+
+    /* What a cached copy of the cell colours (vertex colours or texture)
+     * was last synchronised with */
+    struct SyncState {
+        uint64_t version = UINT64_MAX;
+        size_t   seen    = 0;     // change-log entries already applied
+        bool     heatMap = false;
+    };
+    SyncState batchSync;
+    SyncState textureSync;
+
+    /* Texture mode: texture dimensions may be padded to powers of two */
+    GLuint texture = 0;
+    int    textureWidth  = 0;
+    int    textureHeight = 0;
+    int    maxTextureSize = -1;
+    bool   npotTextures   = false;
+    std::vector<uint8_t> texels; // staging rows for uploads
+
+    /* Level of detail: levels[k - 1] holds the average colour of each
+     * 2^k x 2^k block of cells, built on demand up to the level in use */
+    struct DetailLevel {
+        int width = 0, height = 0;
+        std::vector<uint8_t> rgba;
+    };
+    std::vector<DetailLevel> levels;
+    std::vector<Vector2i>    dirtyBlocks;
+    SyncState levelSync;
+    GLuint levelTexture = 0;
+    int    levelTextureWidth  = 0;
+    int    levelTextureHeight = 0;
+    int    levelTextureShown  = 0; // detail level the texture holds, 0 for none
+    GLuint   pathTexture = 0;
+    int      pathTextureWidth  = 0;
+    int      pathTextureHeight = 0;
+    int      pathTextureLevel  = 0;
+    uint64_t pathTextureRevision = 0;
+    std::vector<float>   levelVertices;
+    std::vector<uint8_t> levelColors;
+
+    void applyCamera() const {
+        if (!viewportWidth) return;
+        float halfWidth = viewportWidth / (2 * zoom), halfHeight = viewportHeight / (2 * zoom);
+        glMatrixMode(GL_PROJECTION);
+        glLoadIdentity();
+        glOrtho(viewX - halfWidth, viewX + halfWidth, viewY + halfHeight, viewY - halfHeight, -1, 1);
+        glMatrixMode(GL_MODELVIEW);
+    }
+
+    CellRect visibleCells(const Maze& maze) const {
+        CellRect rect = {0, 0, maze.getWidth(), maze.getHeight()};
+        if (!viewportWidth) return rect;
+        float halfWidth = viewportWidth / (2 * zoom), halfHeight = viewportHeight / (2 * zoom);
+        rect.x0 = std::max(0, int(std::floor((viewX - halfWidth) / cellSize)));
+        rect.y0 = std::max(0, int(std::floor((viewY - halfHeight) / cellSize)));
+        rect.x1 = std::min(maze.getWidth(),  int(std::ceil((viewX + halfWidth) / cellSize)));
+        rect.y1 = std::min(maze.getHeight(), int(std::ceil((viewY + halfHeight) / cellSize)));
+        rect.x1 = std::max(rect.x0, rect.x1);
+        rect.y1 = std::max(rect.y0, rect.y1);
+        return rect;
+    }
+
+    bool contains(const CellRect& rect, const Vector2i& pos) const {
+        return pos.x >= rect.x0 && pos.x < rect.x1 && pos.y >= rect.y0 && pos.y < rect.y1;
+    }
+
+    /* 0 while cells are at least a pixel wide, otherwise the smallest k
+     * for which a 2^k block of cells is */
+    int detailLevel() const {
+        float pixelsPerCell = cellSize * (viewportWidth ? zoom : 1.0f);
+        int level = 0;
+        while (pixelsPerCell < 1.0f && level < 30) {
+            pixelsPerCell *= 2;
+            level++;
+        }
+        return level;
+    }
+
+    /* Colour of the cell at index i of the maze's layout (Maze::cellIndex) */
+    Color cellColor(const Maze& maze, size_t i, bool heatMap) const {
+        switch (maze.cellData()[i] & CELL_TYPE_MASK) {
+            case PATH:
+                if (heatMap) return heatColor(maze.distanceAt(i), maze.getMaxDistance());
+                return Color(0.9f, 0.9f, 0.9f);
+            case PLAYER: return Color(0.26f, 0.53f, 0.96f);
+            case TARGET: return Color(0.96f, 0.26f, 0.26f);
+            case MUD:    return Color(0.55f, 0.4f, 0.22f);
+            case ICE:    return Color(0.72f, 0.9f, 1.0f);
+            case STAIRS_UP:   return Color(0.98f, 0.75f, 0.18f);
+            case STAIRS_DOWN: return Color(0.62f, 0.42f, 0.86f);
+            case STAIRS:      return Color(0.95f, 0.5f, 0.75f);
+            default:     return Color(0.3f, 0.3f, 0.3f);
+        }
+    }
+
+    static void packColor(const Color& color, uint8_t* rgba) {
+        rgba[0] = uint8_t(color.r * 255);
+        rgba[1] = uint8_t(color.g * 255);
+        rgba[2] = uint8_t(color.b * 255);
+        rgba[3] = 255;
+    }
+
+    static bool needsFullSync(const SyncState& sync, const Maze& maze, bool heatMap) {
+        return sync.version != maze.getVersion() || sync.heatMap != heatMap ||
+               sync.seen > maze.getChangeLog().size();
+    }
+
+    static void markSynced(SyncState& sync, const Maze& maze, bool heatMap) {
+        sync.version = maze.getVersion();
+        sync.seen    = maze.getChangeLog().size();
+        sync.heatMap = heatMap;
+    }
+
+    void drawImmediate(const Maze& maze, const CellRect& view) {
+        bool heatMap = maze.isHeatMapShown() && maze.hasDistanceField();
+        for (int y = view.y0; y < view.y1; y++) {
+            for (int x = view.x0; x < view.x1; x++) {
+                drawCell(x, y, cellColor(maze, maze.cellIndex(x, y), heatMap));
+            }
+        }
+    }
+
+    void drawImmediatePath(const Maze& maze, const CellRect& view) {
+        if (maze.hasPath()) {
+            Color pathColor(0.26f, 0.96f, 0.68f);
+            for (const auto& pos : maze.getPath()) {
+                CellType type = maze.cellType(pos.x, pos.y);
+                if (contains(view, pos) && type != PLAYER && type != TARGET) {
+                    drawPathCell(pos.x, pos.y, pathColor);
+                }
+            }
+        }
+    }
+
+    bool useBufferObjects() {
+#ifdef MAZE_HAVE_BUFFER_OBJECTS
+        if (bufferObjects < 0) {
+            int major = 1, minor = 0;
+            const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+            if (version) std::sscanf(version, "%d.%d", &major, &minor);
+            bufferObjects = major > 1 || minor >= 5;
+        }
+        return bufferObjects == 1;
+#else
+        return false;
+#endif
+    }
+
+    void buildGeometry(const Maze& maze) {
+        int width = maze.getWidth(), height = maze.getHeight();
+        geometryCells = size_t(width) * height;
+        geometryWidth = width;
+        vertices.resize(geometryCells * 8);
+        colors.resize(geometryCells * 16);
+
+        float* v = vertices.data();
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++, v += 8) {
+                float x1 = x * cellSize, y1 = y * cellSize;
+                float x2 = x1 + cellSize, y2 = y1 + cellSize;
+                v[0] = x1; v[1] = y1;  v[2] = x2; v[3] = y1;
+                v[4] = x2; v[5] = y2;  v[6] = x1; v[7] = y2;
+            }
+        }
+
+#ifdef MAZE_HAVE_BUFFER_OBJECTS
+        if (useBufferObjects()) {
+            if (!buffer) glGenBuffers(1, &buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float) + colors.size(),
+                         nullptr, GL_DYNAMIC_DRAW);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(float), vertices.data());
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+#endif
+        batchSync = SyncState();
+    }
+
+    /* Give the four vertices of quad q (row-major, cell (x, y)) its current colour */
+    void updateQuadColor(const Maze& maze, size_t q, int x, int y, bool heatMap) {
+        uint8_t* rgba = &colors[q * 16];
+        packColor(cellColor(maze, maze.cellIndex(x, y), heatMap), rgba);
+        for (int k = 4; k < 16; k++) rgba[k] = rgba[k - 4];
+    }
+
+    void drawBatched(const Maze& maze, const CellRect& view) {
+        if (geometryCells != size_t(maze.getWidth()) * maze.getHeight() ||
+            geometryWidth != maze.getWidth()) {
+            buildGeometry(maze);
+        }
+
+        bool heatMap = maze.isHeatMapShown() && maze.hasDistanceField();
+        bool full = needsFullSync(batchSync, maze, heatMap);
+        const std::vector<uint32_t>& changes = maze.getChangeLog();
+        if (full) {
+            size_t q = 0;
+            for (int y = 0; y < maze.getHeight(); y++) {
+                for (int x = 0; x < maze.getWidth(); x++, q++) updateQuadColor(maze, q, x, y, heatMap);
+            }
+        } else {
+            for (size_t k = batchSync.seen; k < changes.size(); k++) {
+                size_t q = changes[k];
+                updateQuadColor(maze, q, int(q % maze.getWidth()), int(q / maze.getWidth()), heatMap);
+            }
+        }
+
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_COLOR_ARRAY);
+#ifdef MAZE_HAVE_BUFFER_OBJECTS
+        if (useBufferObjects()) {
+            size_t colorOffset = vertices.size() * sizeof(float);
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            if (full) {
+                glBufferSubData(GL_ARRAY_BUFFER, colorOffset, colors.size(), colors.data());
+            } else {
+                for (size_t k = batchSync.seen; k < changes.size(); k++) {
+                    size_t i = changes[k];
+                    glBufferSubData(GL_ARRAY_BUFFER, colorOffset + i * 16, 16, &colors[i * 16]);
+                }
+            }
+            glVertexPointer(2, GL_FLOAT, 0, nullptr);
+            glColorPointer(4, GL_UNSIGNED_BYTE, 0, reinterpret_cast<const void*>(colorOffset));
+            drawVisibleQuads(maze, view);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        } else
+#endif
+        {
+            glVertexPointer(2, GL_FLOAT, 0, vertices.data());
+            glColorPointer(4, GL_UNSIGNED_BYTE, 0, colors.data());
+            drawVisibleQuads(maze, view);
+        }
+        glDisableClientState(GL_COLOR_ARRAY);
+        glDisableClientState(GL_VERTEX_ARRAY);
+        markSynced(batchSync, maze, heatMap);
+    }
+
+    /* A one-pixel line in the background colour along the right and
+     * bottom edge of every visible cell that is at least 4 pixels wide */
+    void drawCellGaps(const CellRect& view) {
+        float pixel = viewportWidth ? 1.0f / zoom : 1.0f;
+        if (cellSize < 4 * pixel) return;
+        GLfloat background[4];
+        glGetFloatv(GL_COLOR_CLEAR_VALUE, background);
+        float left = view.x0 * cellSize, right  = view.x1 * cellSize;
+        float top  = view.y0 * cellSize, bottom = view.y1 * cellSize;
+        gapVertices.clear();
+        for (int x = view.x0; x < view.x1; x++) {
+            float lineX = (x + 1) * cellSize - pixel / 2;
+            float line[4] = {lineX, top, lineX, bottom};
+            gapVertices.insert(gapVertices.end(), line, line + 4);
+        }
+        for (int y = view.y0; y < view.y1; y++) {
+            float lineY = (y + 1) * cellSize - pixel / 2;
+            float line[4] = {left, lineY, right, lineY};
+            gapVertices.insert(gapVertices.end(), line, line + 4);
+        }
+        glColor3f(background[0], background[1], background[2]);
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glVertexPointer(2, GL_FLOAT, 0, gapVertices.data());
+        glDrawArrays(GL_LINES, 0, GLsizei(gapVertices.size() / 2));
+        glDisableClientState(GL_VERTEX_ARRAY);
+    }
+
+    /* Cell quads are stored row by row: whole visible rows go out in one
+     * call, a narrower view takes one call per visible row */
+    void drawVisibleQuads(const Maze& maze, const CellRect& view) {
+        int width = maze.getWidth();
+        if (view.x0 == 0 && view.x1 == width) {
+            glDrawArrays(GL_QUADS, GLint(size_t(view.y0) * width * 4),
+                         GLsizei(size_t(view.y1 - view.y0) * width * 4));
+            return;
+        }
+        for (int y = view.y0; y < view.y1; y++) {
+            glDrawArrays(GL_QUADS, GLint((size_t(y) * width + view.x0) * 4),
+                         GLsizei((view.x1 - view.x0) * 4));
+        }
+    }
+
+    /* The visible part of the shortest path as quads in one glDrawArrays
+     * from client memory; at a detail level above 0 each block on the
+     * path is filled once instead */
+    void drawPathOverlay(const Maze& maze, const CellRect& view, int level) {
+        if (level && maze.hasPath() && textureFits(((maze.getWidth() - 1) >> level) + 1,
+                                                   ((maze.getHeight() - 1) >> level) + 1)) {
+            drawPathMask(maze, level);
+        } else if (maze.hasPath()) {
+            float blockSize = cellSize * (1 << level);
+            float halfSize  = level ? blockSize / 2.0f : cellSize / 4.0f;
+            int blocksWide  = ((maze.getWidth() - 1) >> level) + 1;
+            if (level) pathBlocks.assign(size_t(blocksWide) * (((maze.getHeight() - 1) >> level) + 1), 0);
+            pathVertices.clear();
+            for (const auto& pos : maze.getPath()) {
+                CellType type = maze.cellType(pos.x, pos.y);
+                if (!contains(view, pos) || type == PLAYER || type == TARGET) continue;
+                Vector2i block(pos.x >> level, pos.y >> level);
+                if (level) {
+                    uint8_t& seen = pathBlocks[size_t(block.y) * blocksWide + block.x];
+                    if (seen) continue;
+                    seen = 1;
+                }
+                float cx = block.x * blockSize + blockSize / 2.0f;
+                float cy = block.y * blockSize + blockSize / 2.0f;
+                float quad[8] = {cx - halfSize, cy - halfSize, cx + halfSize, cy - halfSize,
+                                 cx + halfSize, cy + halfSize, cx - halfSize, cy + halfSize};
+                pathVertices.insert(pathVertices.end(), quad, quad + 8);
+            }
+            glColor3f(0.26f, 0.96f, 0.68f);
+            glEnableClientState(GL_VERTEX_ARRAY);
+            glVertexPointer(2, GL_FLOAT, 0, pathVertices.data());
+            glDrawArrays(GL_QUADS, 0, GLsizei(pathVertices.size() / 2));
+            glDisableClientState(GL_VERTEX_ARRAY);
+        }
+    }
+
+    /* The path at a detail level as one alpha-tested quad whose texture
+     * marks the blocks on the path; rebuilt only when the maze changes */
+    void drawPathMask(const Maze& maze, int level) {
+        int blocksWide = ((maze.getWidth()  - 1) >> level) + 1;
+        int blocksHigh = ((maze.getHeight() - 1) >> level) + 1;
+        bool reallocated = prepareTexture(pathTexture, blocksWide, blocksHigh,
+                                          pathTextureWidth, pathTextureHeight, GL_ALPHA);
+        if (reallocated || pathTextureLevel != level || pathTextureRevision != maze.getRevision()) {
+            pathBlocks.assign(size_t(blocksWide) * blocksHigh, 0);
+            for (const auto& pos : maze.getPath()) {
+                CellType type = maze.cellType(pos.x, pos.y);
+                if (type == PLAYER || type == TARGET) continue;
+                pathBlocks[size_t(pos.y >> level) * blocksWide + (pos.x >> level)] = 255;
+            }
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, blocksWide, blocksHigh, GL_ALPHA,
+                            GL_UNSIGNED_BYTE, pathBlocks.data());
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            pathTextureLevel    = level;
+            pathTextureRevision = maze.getRevision();
+        }
+
+        float u = float(maze.getWidth()) / (1 << level) / pathTextureWidth;
+        float v = float(maze.getHeight()) / (1 << level) / pathTextureHeight;
+        glColor3f(0.26f, 0.96f, 0.68f);
+        glEnable(GL_ALPHA_TEST);
+        glAlphaFunc(GL_GREATER, 0.5f);
+        glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+        drawTextureQuad(maze, u, v, false);
+        glDisable(GL_ALPHA_TEST);
+    }
+
+    static int nextPowerOfTwo(int n) {
+        int p = 1;
+        while (p < n) p *= 2;
+        return p;
+    }
+
+    bool textureFits(int width, int height) {
+        if (maxTextureSize < 0) {
+            glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+            int major = 1, minor = 0;
+            const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+            const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+            if (version) std::sscanf(version, "%d.%d", &major, &minor);
+            npotTextures = major >= 2 ||
+                (extensions && std::strstr(extensions, "GL_ARB_texture_non_power_of_two"));
+        }
+        int w = npotTextures ? width  : nextPowerOfTwo(width);
+        int h = npotTextures ? height : nextPowerOfTwo(height);
+        return w <= maxTextureSize && h <= maxTextureSize;
+    }
+
+    /* Bind `id` (created on first use) with storage for a width x height
+     * image, padded to powers of two without NPOT support; true when the
+     * storage was reallocated and has to be filled again */
+    bool prepareTexture(GLuint& id, int width, int height, int& allocWidth, int& allocHeight,
+                        GLenum format = GL_RGBA) {
+        if (!id) glGenTextures(1, &id);
+        glBindTexture(GL_TEXTURE_2D, id);
+
+        int wantWidth  = npotTextures ? width  : nextPowerOfTwo(width);
+        int wantHeight = npotTextures ? height : nextPowerOfTwo(height);
+        if (wantWidth == allocWidth && wantHeight == allocHeight) return false;
+        allocWidth  = wantWidth;
+        allocHeight = wantHeight;
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, allocWidth, allocHeight, 0,
+                     format, GL_UNSIGNED_BYTE, nullptr);
+        return true;
+    }
+
+    /* The bound texture on one quad covering the maze, texels (0, 0) to
+     * (u, v) in normalised coordinates; replacing the colour unless the
+     * caller set up its own texture environment */
+    void drawTextureQuad(const Maze& maze, float u, float v, bool replace = true) {
+        float right = maze.getWidth() * cellSize, bottom = maze.getHeight() * cellSize;
+        glEnable(GL_TEXTURE_2D);
+        if (replace) glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+        glBegin(GL_QUADS);
+        glTexCoord2f(0, 0); glVertex2f(0, 0);
+        glTexCoord2f(u, 0); glVertex2f(right, 0);
+        glTexCoord2f(u, v); glVertex2f(right, bottom);
+        glTexCoord2f(0, v); glVertex2f(0, bottom);
+        glEnd();
+        glDisable(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    /* Upload the colours of the cell rectangle [x0, x1) x [y0, y1) */
+    void uploadTexels(const Maze& maze, int x0, int y0, int x1, int y1, bool heatMap) {
+        int w = x1 - x0;
+        const int rowsPerStrip = std::max(1, 65536 / w);
+        for (int top = y0; top < y1; top += rowsPerStrip) {
+            int rows = std::min(rowsPerStrip, y1 - top);
+            texels.resize(size_t(w) * rows * 4);
+            uint8_t* rgba = texels.data();
+            for (int y = top; y < top + rows; y++) {
+                for (int x = x0; x < x1; x++, rgba += 4) {
+                    packColor(cellColor(maze, maze.cellIndex(x, y), heatMap), rgba);
+                }
+            }
+            glTexSubImage2D(GL_TEXTURE_2D, 0, x0, top, w, rows, GL_RGBA,
+                            GL_UNSIGNED_BYTE, texels.data());
+        }
+    }
+
+    void drawTextured(const Maze& maze) {
+        int width = maze.getWidth(), height = maze.getHeight();
+        bool heatMap = maze.isHeatMapShown() && maze.hasDistanceField();
+
+        if (prepareTexture(texture, width, height, textureWidth, textureHeight)) {
+            textureSync = SyncState();
+        }
+
+        if (needsFullSync(textureSync, maze, heatMap)) {
+            uploadTexels(maze, 0, 0, width, height, heatMap);
+        } else {
+            /* Dirty rectangle: one upload for the bounding box when the
+             * changes are clustered (a move touches two adjacent cells),
+             * otherwise one texel per changed cell */
+            const std::vector<uint32_t>& changes = maze.getChangeLog();
+            size_t count = changes.size() - textureSync.seen;
+            if (count > 0) {
+                int x0 = width, y0 = height, x1 = 0, y1 = 0;
+                for (size_t k = textureSync.seen; k < changes.size(); k++) {
+                    int x = changes[k] % width, y = changes[k] / width;
+                    x0 = std::min(x0, x);  x1 = std::max(x1, x + 1);
+                    y0 = std::min(y0, y);  y1 = std::max(y1, y + 1);
+                }
+                if (size_t(x1 - x0) * (y1 - y0) <= 4 * count) {
+                    uploadTexels(maze, x0, y0, x1, y1, heatMap);
+                } else {
+                    for (size_t k = textureSync.seen; k < changes.size(); k++) {
+                        int x = changes[k] % width, y = changes[k] / width;
+                        uploadTexels(maze, x, y, x + 1, y + 1, heatMap);
+                    }
+                }
+            }
+        }
+        markSynced(textureSync, maze, heatMap);
+
+        drawTextureQuad(maze, float(width) / textureWidth, float(height) / textureHeight);
+    }
+
+    /* Recompute block (bx, by) of detail level `level` from the level
+     * below it, or from the cells for level 1 */
+    void computeBlock(const Maze& maze, size_t level, int bx, int by, bool heatMap) {
+        const DetailLevel* source = level > 1 ? &levels[level - 2] : nullptr;
+        int sourceWidth  = source ? source->width  : maze.getWidth();
+        int sourceHeight = source ? source->height : maze.getHeight();
+        unsigned sum[3] = {0, 0, 0}, count = 0;
+        for (int sy = 2 * by; sy < std::min(2 * by + 2, sourceHeight); sy++) {
+            for (int sx = 2 * bx; sx < std::min(2 * bx + 2, sourceWidth); sx++) {
+                uint8_t rgba[4];
+                const uint8_t* texel = rgba;
+                if (source) texel = &source->rgba[(size_t(sy) * sourceWidth + sx) * 4];
+                else        packColor(cellColor(maze, maze.cellIndex(sx, sy), heatMap), rgba);
+                for (int c = 0; c < 3; c++) sum[c] += texel[c];
+                count++;
+            }
+        }
+        DetailLevel& target = levels[level - 1];
+        uint8_t* out = &target.rgba[(size_t(by) * target.width + bx) * 4];
+        for (int c = 0; c < 3; c++) out[c] = uint8_t(sum[c] / count);
+        out[3] = 255;
+    }
+
+    /* Bring levels 1..level up to date, following the change log; blocks
+     * of `level` that changed are listed in dirtyBlocks */
+    void syncDetailLevels(const Maze& maze, int level, bool heatMap) {
+        dirtyBlocks.clear();
+        if (needsFullSync(levelSync, maze, heatMap) ||
+            (!levels.empty() && levels[0].width != (maze.getWidth() + 1) / 2)) {
+            levels.clear();
+            levelTextureShown = 0;
+        } else {
+            const std::vector<uint32_t>& changes = maze.getChangeLog();
+            for (size_t k = levelSync.seen; k < changes.size(); k++) {
+                int x = changes[k] % maze.getWidth(), y = changes[k] / maze.getWidth();
+                for (size_t l = 1; l <= levels.size(); l++) {
+                    computeBlock(maze, l, x >> l, y >> l, heatMap);
+                }
+                dirtyBlocks.push_back(Vector2i(x >> level, y >> level));
+            }
+        }
+        while (levels.size() < size_t(level)) {
+            int sourceWidth  = levels.empty() ? maze.getWidth()  : levels.back().width;
+            int sourceHeight = levels.empty() ? maze.getHeight() : levels.back().height;
+            levels.emplace_back();
+            DetailLevel& next = levels.back();
+            next.width  = (sourceWidth + 1) / 2;
+            next.height = (sourceHeight + 1) / 2;
+            next.rgba.resize(size_t(next.width) * next.height * 4);
+            for (int by = 0; by < next.height; by++) {
+                for (int bx = 0; bx < next.width; bx++) {
+                    computeBlock(maze, levels.size(), bx, by, heatMap);
+                }
+            }
+        }
+        markSynced(levelSync, maze, heatMap);
+    }
+
+    /* The detail level as a texture on one quad, or one quad per visible
+     * block from client memory when it does not fit in a texture */
+    void drawLevelOfDetail(const Maze& maze, const CellRect& view, int level) {
+        bool heatMap = maze.isHeatMapShown() && maze.hasDistanceField();
+        syncDetailLevels(maze, level, heatMap);
+
+        const DetailLevel& detail = levels[level - 1];
+        int block = 1 << level;
+        if (textureFits(detail.width, detail.height)) {
+            bool reallocated = prepareTexture(levelTexture, detail.width, detail.height,
+                                              levelTextureWidth, levelTextureHeight);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, detail.width);
+            if (reallocated || levelTextureShown != level) {
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, detail.width, detail.height, GL_RGBA,
+                                GL_UNSIGNED_BYTE, detail.rgba.data());
+            } else {
+                for (const Vector2i& b : dirtyBlocks) {
+                    glTexSubImage2D(GL_TEXTURE_2D, 0, b.x, b.y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                                    &detail.rgba[(size_t(b.y) * detail.width + b.x) * 4]);
+                }
+            }
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+            levelTextureShown = level;
+            drawTextureQuad(maze, float(maze.getWidth()) / block / levelTextureWidth,
+                            float(maze.getHeight()) / block / levelTextureHeight);
+            return;
+        }
+
+        float blockSize = cellSize * block;
+        float right = maze.getWidth() * cellSize, bottom = maze.getHeight() * cellSize;
+        int bx1 = std::min(detail.width,  (view.x1 + block - 1) >> level);
+        int by1 = std::min(detail.height, (view.y1 + block - 1) >> level);
+        levelVertices.clear();
+        levelColors.clear();
+        for (int by = view.y0 >> level; by < by1; by++) {
+            for (int bx = view.x0 >> level; bx < bx1; bx++) {
+                float x1 = bx * blockSize, y1 = by * blockSize;
+                float x2 = std::min(right, x1 + blockSize), y2 = std::min(bottom, y1 + blockSize);
+                float quad[8] = {x1, y1, x2, y1, x2, y2, x1, y2};
+                levelVertices.insert(levelVertices.end(), quad, quad + 8);
+                const uint8_t* rgba = &detail.rgba[(size_t(by) * detail.width + bx) * 4];
+                for (int k = 0; k < 4; k++) levelColors.insert(levelColors.end(), rgba, rgba + 4);
+            }
+        }
+
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_COLOR_ARRAY);
+        glVertexPointer(2, GL_FLOAT, 0, levelVertices.data());
+        glColorPointer(4, GL_UNSIGNED_BYTE, 0, levelColors.data());
+        glDrawArrays(GL_QUADS, 0, GLsizei(levelVertices.size() / 2));
+        glDisableClientState(GL_COLOR_ARRAY);
+        glDisableClientState(GL_VERTEX_ARRAY);
+    }
+
+    void drawCell(int x, int y, const Color& color) {
+        glColor3f(color.r, color.g, color.b);
+        glBegin(GL_QUADS);
+        float x1 = x * cellSize;
+        float y1 = y * cellSize;
+        float x2 = x1 + cellSize;
+        float y2 = y1 + cellSize;
+
+        glVertex2f(x1, y1);
+        glVertex2f(x2, y1);
+        glVertex2f(x2, y2);
+        glVertex2f(x1, y2);
+        glEnd();
+    }
+
+    void drawPathCell(int x, int y, const Color& color) {
+        glColor3f(color.r, color.g, color.b);
+        glBegin(GL_QUADS);
+        float centerX = x * cellSize + cellSize / 2.0f;
+        float centerY = y * cellSize + cellSize / 2.0f;
+        float halfSize = cellSize / 4.0f;
+
+        glVertex2f(centerX - halfSize, centerY - halfSize);
+        glVertex2f(centerX + halfSize, centerY - halfSize);
+        glVertex2f(centerX + halfSize, centerY + halfSize);
+        glVertex2f(centerX - halfSize, centerY + halfSize);
+        glEnd();
+    }
+
+    /* Near cells are yellow, the farthest purple */
+    static Color heatColor(uint32_t distance, uint32_t maxDistance) {
+        float t = maxDistance ? float(distance) / maxDistance : 0.0f;
+        return Color(1.0f - 0.7f * t, 0.9f - 0.8f * t, 0.2f + 0.4f * t);
+    }
+};
+
+#endif // MAZE_RENDER_H
@@ -0,0 +1,395 @@
+/*
+ * Maze server: generation and solving over TCP, without GL.
+ *
+ *   g++ -O2 -std=c++14 maze_server.cc -pthread -o maze_server && ./maze_server --port 7700
+ *
+ * Clients send text lines and may pipeline any number of requests without
+ * waiting for answers.  Each round of poll() takes the complete lines of
+ * every connection as one batch, generates the batch's mazes on a thread
+ * pool, then solves its paths there, and answers every request in order:
+ *
+ *   generate W H SEED [GENERATOR]  ->  maze ID W H BYTES\n  + the packed maze
+ *   solve ID AX AY BX BY [SOLVER]  ->  path ID CELLS BYTES\n + the packed steps
+ *   free ID                        ->  freed ID\n
+ *   anything that fails            ->  error MESSAGE\n
+ *
+ * Packed mazes and steps are the formats of maze_file.h (packMaze() and
+ * packPath()), written with writev straight from the buffers they were
+ * built in.  IDs number the generate requests of a connection from 0; a
+ * solve may use a maze generated earlier in the same batch, and a free
+ * takes effect once its batch is answered.  SOLVER is any of the app's
+ * solvers except field, graph and graph-astar, whose precomputed data the
+ * server does not build.  Answers are sent blocking, so a client that
+ * stops reading holds up the others: this is meant for trusted services
+ * on a private network.
+ *
+ * Options:
+ *  --port N        TCP port to listen on (default 7700)
+ *  --threads N     worker threads (default: hardware threads)
+ *  --max-cells N   largest W x H accepted, after rounding up to odd sides of
+ *                  at least 5 (default 67108864)
+ */
+
+#ifdef _WIN32
+#error "maze_server.cc needs POSIX sockets"
+#endif
+
+/* No hot-path table: the pool threads generate and solve at once */
+#define MAZE_STATS 0
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <iostream>
+#include <new>
+
+#include "maze_agents.h"
+#include "maze_core.h"
+#include "maze_file.h"
+
+const size_t MAX_LINE = 4096;
+const int MAX_EXTENT = 1 << 20; // largest side PackedMaze accepts, after normalizeSize()
+
+struct ServedMaze {
+    std::unique_ptr<Maze> maze; // null until generated, or if that failed
+    std::vector<uint8_t> packed;
+};
+
+enum RequestKind {
+    REQUEST_GENERATE,
+    REQUEST_SOLVE,
+    REQUEST_FREE,
+    REQUEST_INVALID
+};
+
+struct Request {
+    RequestKind kind = REQUEST_INVALID;
+    int width = 0, height = 0;
+    uint32_t seed = 0;
+    GeneratorType generator = BACKTRACKER;
+    SolverType solver = SOLVER_BFS;
+    uint32_t id = 0;
+    Vector2i from, to;
+    ServedMaze* target = nullptr; // maze generated or solved
+    std::string error;            // set when the request fails
+    size_t cells = 0;             // path length found
+    std::vector<uint8_t> steps;   // packPath() of it
+    char header[96];
+};
+
+struct Connection {
+    int fd = -1;
+    std::string input; // bytes after the last complete line
+    std::vector<std::unique_ptr<ServedMaze>> mazes; // by ID, null once freed
+    std::vector<Request> batch;
+};
+
+struct ServerOptions {
+    int port = 7700;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t maxCells = size_t(1) << 26;
+};
+
+/* Turn one request line into a batch entry, checking everything that does
+ * not need the maze itself */
+void parseRequest(Connection& connection, const std::string& line, const ServerOptions& options,
+                  Request& request) {
+    char word[32] = "", name[32] = "";
+    int n = 0;
+    if (std::sscanf(line.c_str(), "%31s%n", word, &n) != 1) {
+        request.error = "empty request";
+        return;
+    }
+    const char* rest = line.c_str() + n;
+    if (!std::strcmp(word, "generate")) {
+        int fields = std::sscanf(rest, "%d %d %u %31s", &request.width, &request.height, &request.seed, name);
+        if (fields < 3) {
+            request.error = "usage: generate W H SEED [GENERATOR]";
+        } else if (fields == 4 && !parseGeneratorName(name, request.generator)) {
+            request.error = std::string("unknown generator ") + name;
+        } else if (request.width < 1 || request.height < 1 ||
+                   Maze::normalizeSize(request.width) > MAX_EXTENT ||
+                   Maze::normalizeSize(request.height) > MAX_EXTENT ||
+                   size_t(Maze::normalizeSize(request.width)) * size_t(Maze::normalizeSize(request.height)) >
+                       options.maxCells) {
+            request.error = "maze size out of range";
+        } else {
+            request.kind = REQUEST_GENERATE;
+            request.id = uint32_t(connection.mazes.size());
+            connection.mazes.emplace_back(new ServedMaze());
+            request.target = connection.mazes.back().get();
+        }
+    } else if (!std::strcmp(word, "solve")) {
+        int fields = std::sscanf(rest, "%u %d %d %d %d %31s", &request.id, &request.from.x, &request.from.y,
+                                 &request.to.x, &request.to.y, name);
+        if (fields < 5) {
+            request.error = "usage: solve ID AX AY BX BY [SOLVER]";
+        } else if (fields == 6 && !parseSolverName(name, request.solver)) {
+            request.error = std::string("unknown solver ") + name;
+        } else if (Maze::usesPrecomputed(request.solver)) {
+            request.error = std::string("solver ") + name + " is not served";
+        } else if (request.id >= connection.mazes.size() || !connection.mazes[request.id]) {
+            request.error = "no maze " + std::to_string(request.id);
+        } else {
+            request.kind = REQUEST_SOLVE;
+            request.target = connection.mazes[request.id].get();
+        }
+    } else if (!std::strcmp(word, "free")) {
+        if (std::sscanf(rest, "%u", &request.id) != 1) {
+            request.error = "usage: free ID";
+        } else if (request.id >= connection.mazes.size() || !connection.mazes[request.id]) {
+            request.error = "no maze " + std::to_string(request.id);
+        } else {
+            request.kind = REQUEST_FREE;
+        }
+    } else {
+        request.error = std::string("unknown request ") + word;
+    }
+}
+
+/* Generate, then solve, every request of the batch on the pool.  Each
+ * worker keeps its scratch and path buffer between batches. */
+class BatchRunner {
+public:
+    explicit BatchRunner(int threads) : pool(threads), scratch(pool.size()), paths(pool.size()) {}
+
+    int getThreads() const { return pool.size(); }
+
+    void run(std::vector<Connection*>& ready) {
+        generates.clear();
+        solves.clear();
+        for (Connection* connection : ready) {
+            for (Request& request : connection->batch) {
+                if (request.kind == REQUEST_GENERATE) generates.push_back(&request);
+                if (request.kind == REQUEST_SOLVE) solves.push_back(&request);
+            }
+        }
+        pool.run(generates.size(), [this](size_t i, int) { generate(*generates[i]); });
+        pool.run(solves.size(), [this](size_t i, int worker) { solve(*solves[i], worker); });
+    }
+
+private:
+    ThreadPool pool;
+    std::vector<SolverScratch> scratch;
+    std::vector<std::vector<Vector2i>> paths;
+    std::vector<Request*> generates, solves;
+
+    static void generate(Request& request) {
+        try {
+            request.target->maze.reset(new Maze(request.width, request.height, request.generator, 1,
+                                                request.seed));
+            packMaze(*request.target->maze, request.target->packed);
+        } catch (const std::bad_alloc&) {
+            request.target->maze.reset();
+            request.error = "out of memory";
+        }
+    }
+
+    void solve(Request& request, int worker) {
+        const Maze* maze = request.target->maze.get();
+        if (!maze) {
+            request.error = "maze " + std::to_string(request.id) + " was not generated";
+            return;
+        }
+        SolveStats stats;
+        std::vector<Vector2i>& path = paths[worker];
+        try {
+            if (!maze->solve(request.solver, request.from, request.to, scratch[worker], path, stats)) {
+                request.error = "no path";
+                return;
+            }
+            packPath(request.from, path, request.steps);
+            request.cells = path.size();
+        } catch (const std::bad_alloc&) {
+            request.error = "out of memory";
+        }
+    }
+};
+
+/* Send everything in `parts`, continuing after partial writes */
+bool sendAll(int fd, std::vector<iovec>& parts) {
+    size_t first = 0;
+    while (first < parts.size()) {
+        int count = int(std::min<size_t>(parts.size() - first, IOV_MAX));
+        ssize_t sent = writev(fd, &parts[first], count);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        size_t left = size_t(sent);
+        while (first < parts.size() && left >= parts[first].iov_len) left -= parts[first++].iov_len;
+        if (left) {
+            parts[first].iov_base = static_cast<char*>(parts[first].iov_base) + left;
+            parts[first].iov_len -= left;
+        }
+    }
+    return true;
+}
+
+/* Write the answers of the connection's batch in order; false if the
+ * connection broke */
+bool answer(Connection& connection, std::vector<iovec>& parts) {
+    parts.clear();
+    for (Request& request : connection.batch) {
+        const void* payload = nullptr;
+        size_t payloadSize = 0;
+        int length;
+        if (!request.error.empty()) {
+            length = std::snprintf(request.header, sizeof(request.header), "error %s\n",
+                                   request.error.c_str());
+        } else if (request.kind == REQUEST_GENERATE) {
+            const Maze& maze = *request.target->maze;
+            payload = request.target->packed.data();
+            payloadSize = request.target->packed.size();
+            length = std::snprintf(request.header, sizeof(request.header), "maze %u %d %d %zu\n",
+                                   request.id, maze.getWidth(), maze.getHeight(), payloadSize);
+        } else if (request.kind == REQUEST_SOLVE) {
+            payload = request.steps.data();
+            payloadSize = request.steps.size();
+            length = std::snprintf(request.header, sizeof(request.header), "path %u %zu %zu\n",
+                                   request.id, request.cells, payloadSize);
+        } else {
+            length = std::snprintf(request.header, sizeof(request.header), "freed %u\n", request.id);
+        }
+        /* Long error messages are cut, but always end the line */
+        if (length >= int(sizeof(request.header))) {
+            length = int(sizeof(request.header)) - 1;
+            request.header[length - 1] = '\n';
+        }
+        parts.push_back({request.header, size_t(length)});
+        if (payloadSize) parts.push_back({const_cast<void*>(payload), payloadSize});
+    }
+    bool ok = sendAll(connection.fd, parts);
+    for (Request& request : connection.batch) {
+        if (request.kind == REQUEST_FREE && request.error.empty()) connection.mazes[request.id].reset();
+    }
+    connection.batch.clear();
+    return ok;
+}
+
+/* Read what arrived and queue its complete lines; false once the
+ * connection is closed or misbehaves */
+bool receive(Connection& connection, const ServerOptions& options) {
+    char buffer[65536];
+    ssize_t got = recv(connection.fd, buffer, sizeof(buffer), 0);
+    if (got < 0 && errno == EINTR) return true;
+    if (got <= 0) return false;
+    connection.input.append(buffer, size_t(got));
+
+    size_t start = 0, end;
+    while ((end = connection.input.find('\n', start)) != std::string::npos) {
+        std::string line = connection.input.substr(start, end - start);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        start = end + 1;
+        if (line.empty()) continue;
+        connection.batch.emplace_back();
+        parseRequest(connection, line, options, connection.batch.back());
+    }
+    connection.input.erase(0, start);
+    return connection.input.size() <= MAX_LINE;
+}
+
+int listenOn(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    int yes = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(uint16_t(port));
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(fd, 64) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void parseServerArgs(int argc, char** argv, ServerOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        if (!std::strcmp(argv[i], "--port") && i + 1 < argc) {
+            options.port = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--threads") && i + 1 < argc) {
+            options.threads = std::max(1, std::atoi(argv[++i]));
+        } else if (!std::strcmp(argv[i], "--max-cells") && i + 1 < argc) {
+            options.maxCells = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            std::cerr << "Unknown argument: " << argv[i] << std::endl;
+            exit(1);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    ServerOptions options;
+    parseServerArgs(argc, argv, options);
+    signal(SIGPIPE, SIG_IGN);
+
+    int listener = listenOn(options.port);
+    if (listener < 0) {
+        std::cerr << "Cannot listen on port " << options.port << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    BatchRunner runner(options.threads);
+    std::cout << "Serving mazes on port " << options.port << " with " << runner.getThreads()
+              << " threads" << std::endl;
+
+    std::vector<std::unique_ptr<Connection>> connections;
+    std::vector<pollfd> polled;
+    std::vector<Connection*> ready;
+    std::vector<iovec> parts;
+    for (;;) {
+        polled.assign(1, {listener, POLLIN, 0});
+        for (auto& connection : connections) polled.push_back({connection->fd, POLLIN, 0});
+        if (poll(polled.data(), polled.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "poll: " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+
+        /* Gather the batch from every connection with input */
+        ready.clear();
+        for (size_t c = 0; c < connections.size(); c++) {
+            Connection& connection = *connections[c];
+            if (!polled[c + 1].revents) continue;
+            if (!receive(connection, options)) {
+                close(connection.fd);
+                connection.fd = -1;
+                continue;
+            }
+            if (!connection.batch.empty()) ready.push_back(&connection);
+        }
+
+        runner.run(ready);
+        for (Connection* connection : ready) {
+            if (!answer(*connection, parts)) {
+                close(connection->fd);
+                connection->fd = -1;
+            }
+        }
+        connections.erase(std::remove_if(connections.begin(), connections.end(),
+                                         [](const std::unique_ptr<Connection>& connection) {
+                                             return connection->fd < 0;
+                                         }),
+                          connections.end());
+
+        if (polled[0].revents & POLLIN) {
+            int fd = accept(listener, nullptr, nullptr);
+            if (fd >= 0) {
+                int yes = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+                connections.emplace_back(new Connection());
+                connections.back()->fd = fd;
+            }
+        }
+    }
+}
@@ -0,0 +1,184 @@
+/*
+ * Hot-path instrumentation.
+ *
+ * A ScopedTimer placed at the top of a function adds one call, its
+ * duration and the heap allocations made meanwhile to that function's
+ * section; solves also add their cells expanded and queue high-water mark.
+ * Everything is a relaxed atomic in one process-wide table, so the agent
+ * thread pool can record too.  Allocations are only counted in programs
+ * linked with maze_alloc.cc (the app and the bench).
+ * The table is shown by the app's HUD and written as JSON or CSV by
+ * writeStats().
+ *
+ * MAZE_STATS (default 1) switches the recording at compile time.  The C
+ * library and the server define it to 0 before any include: their pool
+ * threads solve concurrently, so a shared table would only cost atomics
+ * on shared cache lines and two clock reads per call, and its "last"
+ * values and allocation deltas would mix up other threads' work.  Every
+ * translation unit of one program must agree on it.
+ */
+
+#ifndef MAZE_STATS_H
+#define MAZE_STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#ifndef MAZE_STATS
+#define MAZE_STATS 1
+#endif
+
+enum StatSection {
+    STAT_GENERATE,
+    STAT_SOLVE,
+    STAT_RECONSTRUCT,
+    STAT_AUTO_MOVE,
+    STAT_DRAW,
+    STAT_SECTION_COUNT
+};
+
+inline const char* statSectionName(StatSection section) {
+    switch (section) {
+        case STAT_GENERATE:    return "generate";
+        case STAT_SOLVE:       return "solve";
+        case STAT_RECONSTRUCT: return "reconstruct";
+        case STAT_AUTO_MOVE:   return "auto_move";
+        case STAT_DRAW:        return "draw";
+        default:               return "unknown";
+    }
+}
+
+/* Bumped by the operator new of maze_alloc.cc in programs that link it */
+inline std::atomic<uint64_t>& allocationCount() {
+    static std::atomic<uint64_t> count(0);
+    return count;
+}
+
+struct SectionStats {
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> totalNanos{0};
+    std::atomic<uint64_t> maxNanos{0};
+    std::atomic<uint64_t> lastNanos{0};
+    std::atomic<uint64_t> allocations{0};
+};
+
+struct HotPathStats {
+    SectionStats sections[STAT_SECTION_COUNT];
+    std::atomic<uint64_t> cellsExpanded{0}; // summed over all solves
+    std::atomic<uint64_t> queuePeak{0};     // largest solver frontier seen
+    std::atomic<uint64_t> lastCellsExpanded{0};
+    std::atomic<uint64_t> lastQueuePeak{0};
+};
+
+inline HotPathStats& hotPathStats() {
+    static HotPathStats stats;
+    return stats;
+}
+
+inline void raiseToAtLeast(std::atomic<uint64_t>& value, uint64_t candidate) {
+    uint64_t seen = value.load(std::memory_order_relaxed);
+    while (seen < candidate &&
+           !value.compare_exchange_weak(seen, candidate, std::memory_order_relaxed)) {}
+}
+
+#if MAZE_STATS
+/* Counters of one finished solve */
+inline void recordSolveCounters(uint64_t cellsExpanded, uint64_t queuePeak) {
+    HotPathStats& stats = hotPathStats();
+    stats.cellsExpanded.fetch_add(cellsExpanded, std::memory_order_relaxed);
+    stats.lastCellsExpanded.store(cellsExpanded, std::memory_order_relaxed);
+    stats.lastQueuePeak.store(queuePeak, std::memory_order_relaxed);
+    raiseToAtLeast(stats.queuePeak, queuePeak);
+}
+
+class ScopedTimer {
+public:
+    explicit ScopedTimer(StatSection section)
+        : section(section), allocationsBefore(allocationCount().load(std::memory_order_relaxed)),
+          start(std::chrono::steady_clock::now()) {}
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    ~ScopedTimer() {
+        uint64_t nanos = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+        SectionStats& stats = hotPathStats().sections[section];
+        stats.calls.fetch_add(1, std::memory_order_relaxed);
+        stats.totalNanos.fetch_add(nanos, std::memory_order_relaxed);
+        stats.lastNanos.store(nanos, std::memory_order_relaxed);
+        stats.allocations.fetch_add(allocationCount().load(std::memory_order_relaxed) - allocationsBefore,
+                                    std::memory_order_relaxed);
+        raiseToAtLeast(stats.maxNanos, nanos);
+    }
+
+private:
+    StatSection section;
+    uint64_t allocationsBefore;
+    std::chrono::steady_clock::time_point start;
+};
+#else
+inline void recordSolveCounters(uint64_t, uint64_t) {}
+
+class ScopedTimer {
+public:
+    explicit ScopedTimer(StatSection) {}
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+#endif
+
+/* Write the table to `path`: CSV (metric,value rows) when the name ends
+ * in .csv, JSON otherwise.  Times are in microseconds. */
+inline bool writeStats(const char* path, std::string& error) {
+    FILE* file = std::fopen(path, "w");
+    if (!file) {
+        error = std::string("cannot create ") + path;
+        return false;
+    }
+    const HotPathStats& stats = hotPathStats();
+    size_t length = std::strlen(path);
+    bool csv = length >= 4 && !std::strcmp(path + length - 4, ".csv");
+
+    if (csv) std::fprintf(file, "metric,value\n");
+    else     std::fprintf(file, "{\n  \"sections\": {\n");
+    for (int s = 0; s < STAT_SECTION_COUNT; s++) {
+        const SectionStats& section = stats.sections[s];
+        const char* name = statSectionName(StatSection(s));
+        uint64_t calls = section.calls.load();
+        double total = section.totalNanos.load() / 1000.0;
+        double mean  = calls ? total / calls : 0.0;
+        double max   = section.maxNanos.load() / 1000.0;
+        double last  = section.lastNanos.load() / 1000.0;
+        unsigned long long allocations = section.allocations.load();
+        if (csv) {
+            std::fprintf(file, "%s.calls,%llu\n%s.total_us,%.3f\n%s.mean_us,%.3f\n"
+                         "%s.max_us,%.3f\n%s.last_us,%.3f\n%s.allocations,%llu\n",
+                         name, static_cast<unsigned long long>(calls), name, total, name, mean,
+                         name, max, name, last, name, allocations);
+        } else {
+            std::fprintf(file, "    \"%s\": {\"calls\": %llu, \"total_us\": %.3f, \"mean_us\": %.3f, "
+                         "\"max_us\": %.3f, \"last_us\": %.3f, \"allocations\": %llu}%s\n",
+                         name, static_cast<unsigned long long>(calls), total, mean, max, last,
+                         allocations, s + 1 < STAT_SECTION_COUNT ? "," : "");
+        }
+    }
+    unsigned long long expanded = stats.cellsExpanded.load(), peak = stats.queuePeak.load();
+    unsigned long long allocations = allocationCount().load();
+    if (csv) {
+        std::fprintf(file, "cells_expanded,%llu\nqueue_peak,%llu\nallocations,%llu\n",
+                     expanded, peak, allocations);
+    } else {
+        std::fprintf(file, "  },\n  \"cells_expanded\": %llu,\n  \"queue_peak\": %llu,\n"
+                     "  \"allocations\": %llu\n}\n", expanded, peak, allocations);
+    }
+    bool ok = !std::ferror(file);
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok) error = std::string("cannot write ") + path;
+    return ok;
+}
+
+#endif // MAZE_STATS_H